@@ -0,0 +1,277 @@
+#include "llvm/Transforms/Utils/CRCDescriptor.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace llvm;
+
+// CRC-16/ARC: the CRC that crcu8 (CoreMark's crcu8) updates one byte at a time.
+static const CRCDescriptor CRCU8Descriptor = {
+    /*Width=*/16,    /*Poly=*/0x8005, /*RefIn=*/true,   /*RefOut=*/true,
+    /*Init=*/0x0000, /*XorOut=*/0x0000, /*DataWidth=*/8};
+
+// Reverse the order of the low Width bits of V.
+static uint64_t reflect(uint64_t V, unsigned Width) {
+  return reverseBits(V) >> (64 - Width);
+}
+
+const CRCDescriptor &llvm::getCRCU8Descriptor() { return CRCU8Descriptor; }
+
+APInt llvm::evaluateCRCStep(const CRCDescriptor &Desc, const APInt &Data,
+                            const APInt &Crc) {
+  assert(Desc.Width > 0 && Desc.Width <= 64 && "Unsupported CRC width");
+  assert(Crc.getBitWidth() >= Desc.Width && "CRC register is too narrow");
+  assert(Desc.DataWidth <= 64 && "Unsupported data width");
+
+  uint64_t Mask = maskTrailingOnes<uint64_t>(Desc.Width);
+  uint64_t Reg = Crc.getZExtValue() & Mask;
+  uint64_t D = Data.getZExtValue();
+
+  // Bit-serial division, the same loop crcu8 runs, so it is correct for any
+  // combination of Width and DataWidth.
+  if (Desc.RefIn) {
+    uint64_t RevPoly = reflect(Desc.Poly, Desc.Width);
+    for (unsigned I = 0; I < Desc.DataWidth; ++I) {
+      bool Carry = (Reg ^ (D >> I)) & 1;
+      Reg >>= 1;
+      if (Carry)
+        Reg ^= RevPoly;
+    }
+  } else {
+    for (unsigned I = Desc.DataWidth; I-- > 0;) {
+      bool Carry = ((Reg >> (Desc.Width - 1)) ^ (D >> I)) & 1;
+      Reg = (Reg << 1) & Mask;
+      if (Carry)
+        Reg ^= Desc.Poly;
+    }
+  }
+
+  return APInt(Crc.getBitWidth(), Reg);
+}
+
+APInt llvm::evaluateCRCOverBuffer(const CRCDescriptor &Desc,
+                                  const ConstantDataSequential &Buffer,
+                                  unsigned Begin, unsigned Count, APInt Crc) {
+  assert(Buffer.getElementType()->isIntegerTy() && "Expected integer buffer");
+  assert(Begin + Count <= Buffer.getNumElements() && "Out of bounds");
+
+  CRCDescriptor Step = Desc;
+  Step.DataWidth = Buffer.getElementType()->getIntegerBitWidth();
+  for (unsigned I = Begin, E = Begin + Count; I != E; ++I)
+    Crc = evaluateCRCStep(Step, APInt(64, Buffer.getElementAsInteger(I)), Crc);
+
+  return Crc;
+}
+
+// Return A * x mod P for an MSB-first register A.
+static uint64_t multiplyByX(const CRCDescriptor &Desc, uint64_t A) {
+  uint64_t Mask = maskTrailingOnes<uint64_t>(Desc.Width);
+  bool Carry = (A >> (Desc.Width - 1)) & 1;
+  A = (A << 1) & Mask;
+  return Carry ? A ^ (Desc.Poly & Mask) : A;
+}
+
+// Return A * B mod P for MSB-first registers A and B.
+static uint64_t multiplyModPoly(const CRCDescriptor &Desc, uint64_t A,
+                                uint64_t B) {
+  uint64_t Product = 0;
+  for (unsigned I = Desc.Width; I-- > 0;) {
+    Product = multiplyByX(Desc, Product);
+    if ((B >> I) & 1)
+      Product ^= A;
+  }
+  return Product;
+}
+
+APInt llvm::evaluateCRCOverZeros(const CRCDescriptor &Desc, uint64_t NumSteps,
+                                 const APInt &Crc) {
+  assert(Desc.Width > 0 && Desc.Width <= 64 && "Unsupported CRC width");
+  uint64_t Reg = Crc.getZExtValue() & maskTrailingOnes<uint64_t>(Desc.Width);
+  if (Desc.RefIn)
+    Reg = reflect(Reg, Desc.Width);
+
+  // Square-and-multiply with x^DataWidth mod P.
+  uint64_t Power = 1;
+  for (unsigned I = 0; I < Desc.DataWidth; ++I)
+    Power = multiplyByX(Desc, Power);
+  for (; NumSteps; NumSteps >>= 1) {
+    if (NumSteps & 1)
+      Reg = multiplyModPoly(Desc, Reg, Power);
+    Power = multiplyModPoly(Desc, Power, Power);
+  }
+
+  if (Desc.RefIn)
+    Reg = reflect(Reg, Desc.Width);
+  return APInt(Crc.getBitWidth(), Reg);
+}
+
+void llvm::computeCRCTable(const CRCDescriptor &Desc,
+                           MutableArrayRef<uint64_t> Table) {
+  assert(Desc.Width >= 8 && Desc.Width <= 64 && "Unsupported CRC width");
+  assert(Table.size() == 256 && "Expected one entry per byte");
+
+  CRCDescriptor Step = Desc;
+  Step.DataWidth = 8;
+  APInt Zero(64, 0);
+  for (unsigned I = 0; I < 256; ++I)
+    Table[I] = evaluateCRCStep(Step, APInt(64, I), Zero).getZExtValue();
+}
+
+std::optional<CRCDescriptor>
+llvm::matchCRCTable(const ConstantDataArray &Table) {
+  if (!Table.getElementType()->isIntegerTy() || Table.getNumElements() != 256)
+    return std::nullopt;
+
+  // The entries never have bits at or above the width, and every polynomial
+  // used for CRCs has its x^0 term, which ends up in the top bit of the
+  // reflected polynomial and in bit 0 of the MSB-first one.
+  uint64_t Bits = 0;
+  for (unsigned I = 0; I < 256; ++I)
+    Bits |= Table.getElementAsInteger(I);
+  unsigned Width = 64 - countLeadingZeros(Bits);
+  if (Width < 8)
+    return std::nullopt;
+
+  // A single data bit that enters first is reduced by the polynomial once
+  // the whole byte has been shifted in: Table[0x80] is the reflected
+  // polynomial and Table[0x01] the MSB-first one.
+  SmallVector<CRCDescriptor, 2> Candidates;
+  uint64_t Reflected = Table.getElementAsInteger(0x80);
+  if (Reflected >> (Width - 1))
+    Candidates.push_back({Width, reflect(Reflected, Width), /*RefIn=*/true,
+                          /*RefOut=*/true, 0, 0, /*DataWidth=*/8});
+  uint64_t Poly = Table.getElementAsInteger(0x01);
+  if (Poly & 1)
+    Candidates.push_back({Width, Poly, /*RefIn=*/false, /*RefOut=*/false, 0, 0,
+                          /*DataWidth=*/8});
+
+  uint64_t Expected[256];
+  for (const CRCDescriptor &Desc : Candidates) {
+    computeCRCTable(Desc, Expected);
+    bool Matches = true;
+    for (unsigned I = 0; I < 256 && Matches; ++I)
+      Matches = Table.getElementAsInteger(I) == Expected[I];
+    if (Matches)
+      return Desc;
+  }
+
+  return std::nullopt;
+}
+
+KnownBits llvm::computeKnownBitsForCRCStep(const CRCDescriptor &Desc,
+                                           const KnownBits &Data,
+                                           const KnownBits &Crc) {
+  unsigned BitWidth = Crc.getBitWidth();
+  APInt NoData(64, 0);
+  APInt NoCrc(BitWidth, 0);
+
+  // Collect the result bits that depend on at least one unknown input bit.
+  APInt Unknown(BitWidth, 0);
+  for (unsigned I = 0; I < Desc.DataWidth; ++I)
+    if (I >= Data.getBitWidth() || (!Data.Zero[I] && !Data.One[I]))
+      Unknown |= evaluateCRCStep(Desc, APInt::getOneBitSet(64, I), NoCrc);
+  for (unsigned I = 0; I < Desc.Width; ++I)
+    if (!Crc.Zero[I] && !Crc.One[I])
+      Unknown |= evaluateCRCStep(Desc, NoData,
+                                 APInt::getOneBitSet(BitWidth, I));
+
+  // The remaining bits are the XOR of known input bits only, so evaluating
+  // the step with every unknown input bit cleared gives their values.
+  APInt DataOne = Data.One.zextOrTrunc(64) &
+                  APInt::getLowBitsSet(64, Desc.DataWidth);
+  APInt Value = evaluateCRCStep(Desc, DataOne, Crc.One);
+
+  KnownBits Known(BitWidth);
+  Known.One = Value & ~Unknown;
+  Known.Zero = ~Value & ~Unknown;
+  return Known;
+}
+
+void llvm::computeDemandedBitsForCRCStep(const CRCDescriptor &Desc,
+                                         const APInt &DemandedResult,
+                                         APInt &DemandedData,
+                                         APInt &DemandedCrc) {
+  unsigned BitWidth = std::max(DemandedResult.getBitWidth(), Desc.Width);
+  APInt Demanded = DemandedResult.zextOrTrunc(BitWidth);
+  APInt NoData(64, 0);
+  APInt NoCrc(BitWidth, 0);
+
+  DemandedData.clearAllBits();
+  for (unsigned I = 0; I < Desc.DataWidth && I < DemandedData.getBitWidth();
+       ++I)
+    if (evaluateCRCStep(Desc, APInt::getOneBitSet(64, I), NoCrc)
+            .intersects(Demanded))
+      DemandedData.setBit(I);
+
+  DemandedCrc.clearAllBits();
+  for (unsigned I = 0; I < Desc.Width && I < DemandedCrc.getBitWidth(); ++I)
+    if (evaluateCRCStep(Desc, NoData, APInt::getOneBitSet(BitWidth, I))
+            .intersects(Demanded))
+      DemandedCrc.setBit(I);
+}
+
+CRCBarrettConstants llvm::getCRCBarrettConstants(const CRCDescriptor &Desc) {
+  unsigned W = Desc.Width;
+  unsigned K = Desc.DataWidth;
+  assert(W < 64 && (Desc.RefIn ? W + K < 64 : K <= W) &&
+         "Unsupported CRC for carry-less multiplication");
+
+  // Long division of x^(W+K) by P = x^W + Poly over GF(2).
+  APInt P(W + K + 1, Desc.Poly);
+  P.setBit(W);
+  APInt Rem = APInt::getOneBitSet(W + K + 1, W + K);
+  uint64_t Quotient = 0;
+  for (unsigned Bit = W + K + 1; Bit-- > W;) {
+    if (!Rem[Bit])
+      continue;
+    Rem ^= P.shl(Bit - W);
+    Quotient |= uint64_t(1) << (Bit - W);
+  }
+
+  if (!Desc.RefIn)
+    return {Quotient, Desc.Poly};
+  return {reflect(Quotient, K + 1), reflect(Desc.Poly, W) << 1 | 1};
+}
+
+const CRCDescriptor *llvm::getCRCStepWrapperDescriptor(const Function &F) {
+  if (F.isDeclaration() || F.arg_size() != 2)
+    return nullptr;
+
+  const IntrinsicInst *Step = nullptr;
+  for (const BasicBlock &BB : F) {
+    for (const Instruction &I : BB) {
+      if (const auto *RI = dyn_cast<ReturnInst>(&I)) {
+        const auto *II = dyn_cast_or_null<IntrinsicInst>(RI->getReturnValue());
+        if (!II || II->getIntrinsicID() != Intrinsic::riscv_crc_petar ||
+            (Step && Step != II))
+          return nullptr;
+        Step = II;
+        continue;
+      }
+
+      // The recognizer leaves the (now dead) stores to the parameter slots
+      // behind; anything else that touches memory disqualifies F.
+      if (const auto *SI = dyn_cast<StoreInst>(&I))
+        if (isa<AllocaInst>(SI->getPointerOperand()->stripPointerCasts()))
+          continue;
+      if (const auto *II = dyn_cast<IntrinsicInst>(&I))
+        if (II->getIntrinsicID() == Intrinsic::riscv_crc_petar ||
+            isa<DbgInfoIntrinsic>(II) || II->isLifetimeStartOrEnd())
+          continue;
+      if (I.mayHaveSideEffects())
+        return nullptr;
+    }
+  }
+
+  if (!Step || Step->getArgOperand(0) != F.getArg(0) ||
+      Step->getArgOperand(1) != F.getArg(1))
+    return nullptr;
+
+  return &CRCU8Descriptor;
+}
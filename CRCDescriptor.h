@@ -0,0 +1,103 @@
+#ifndef LLVM_TRANSFORMS_RECOGNIZINGCRC_CRCDESCRIPTOR_H
+#define LLVM_TRANSFORMS_RECOGNIZINGCRC_CRCDESCRIPTOR_H
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/KnownBits.h"
+#include <cstdint>
+#include <optional>
+
+namespace llvm {
+
+class ConstantDataArray;
+class ConstantDataSequential;
+class Function;
+
+// Parameters of a CRC algorithm in the Rocksoft model (width, poly, refin,
+// refout, init, xorout). Poly is written MSB-first without the x^Width term,
+// so the CRC computed by crcu8 is described as 0x8005 with reflected input
+// and output, even though its source code XORs the reversed value 0xA001.
+// DataWidth is the number of message bits consumed by one step.
+struct CRCDescriptor {
+  unsigned Width;
+  uint64_t Poly;
+  bool RefIn;
+  bool RefOut;
+  uint64_t Init;
+  uint64_t XorOut;
+  unsigned DataWidth;
+};
+
+// Descriptor of the CRC step computed by crcu8 and llvm.riscv.crc.petar:
+// CRC-16/ARC, eight data bits per step.
+const CRCDescriptor &getCRCU8Descriptor();
+
+// Feed the low Desc.DataWidth bits of Data into the CRC register Crc and
+// return the new register value. The register is kept in the domain the
+// algorithm works in (reflected when Desc.RefIn is set), so neither Init nor
+// XorOut is applied, exactly like a single call of crcu8.
+APInt evaluateCRCStep(const CRCDescriptor &Desc, const APInt &Data,
+                      const APInt &Crc);
+
+// Feed Count elements of Buffer, starting at element Begin, into Crc, one step
+// per element. The element width overrides Desc.DataWidth.
+APInt evaluateCRCOverBuffer(const CRCDescriptor &Desc,
+                            const ConstantDataSequential &Buffer,
+                            unsigned Begin, unsigned Count, APInt Crc);
+
+// Feed NumSteps steps of zero data into Crc. Every zero step multiplies the
+// register by x^DataWidth modulo the polynomial, so this takes O(log NumSteps)
+// multiplications instead of NumSteps steps.
+APInt evaluateCRCOverZeros(const CRCDescriptor &Desc, uint64_t NumSteps,
+                           const APInt &Crc);
+
+// Fill the 256 entries of the table of a byte-wise (Sarwate) implementation:
+// Table[I] is the register after one eight bit step of I into a zero
+// register, so a step is
+//   crc = (crc >> 8) ^ Table[(crc ^ data) & 0xff]                 (reflected)
+//   crc = (crc << 8) ^ Table[((crc >> (Width - 8)) ^ data) & 0xff] (MSB-first)
+// Requires Width >= 8.
+void computeCRCTable(const CRCDescriptor &Desc, MutableArrayRef<uint64_t> Table);
+
+// If Table holds the 256 entries of a Sarwate table, return the descriptor
+// (with DataWidth 8, Init and XorOut 0) it was computed for. The width and
+// polynomial are read from the entries for the single bits and the whole
+// table is recomputed to check them.
+std::optional<CRCDescriptor> matchCRCTable(const ConstantDataArray &Table);
+
+// A CRC step is linear over GF(2) in the data and the CRC register, so every
+// result bit is the XOR of a fixed set of input bits. A result bit is known
+// when all of the input bits it depends on are known. The result has the bit
+// width of Crc; bits at and above Desc.Width are always zero.
+KnownBits computeKnownBitsForCRCStep(const CRCDescriptor &Desc,
+                                     const KnownBits &Data,
+                                     const KnownBits &Crc);
+
+// Compute which bits of the data and of the CRC register are needed for the
+// DemandedResult bits of a CRC step. DemandedData and DemandedCrc are
+// overwritten and keep their bit widths.
+void computeDemandedBitsForCRCStep(const CRCDescriptor &Desc,
+                                   const APInt &DemandedResult,
+                                   APInt &DemandedData, APInt &DemandedCrc);
+
+// Constants for computing a CRC step with two carry-less multiplications
+// (Barrett reduction). Quotient is floor(x^(Width+DataWidth) / P). Poly is
+// what the truncated quotient is multiplied with: P without its x^Width term
+// for MSB-first CRCs, or the whole P bit-reflected for reflected ones, whose
+// Quotient is reflected as well. Requires Width < 64, and DataWidth <= Width
+// for MSB-first CRCs or DataWidth + Width < 64 for reflected ones, which
+// consume data wider than the register (fused steps) in the same way.
+struct CRCBarrettConstants {
+  uint64_t Quotient;
+  uint64_t Poly;
+};
+CRCBarrettConstants getCRCBarrettConstants(const CRCDescriptor &Desc);
+
+// If F only forwards its two arguments to llvm.riscv.crc.petar and returns
+// the result (which is what crcu8 looks like after it has been recognized),
+// return the descriptor of the computed step, otherwise return nullptr.
+const CRCDescriptor *getCRCStepWrapperDescriptor(const Function &F);
+
+} // namespace llvm
+
+#endif // LLVM_TRANSFORMS_RECOGNIZINGCRC_CRCDESCRIPTOR_H
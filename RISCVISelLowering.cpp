@@ -41,6 +41,7 @@
 #include "llvm/Support/KnownBits.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/CRCDescriptor.h"
 #include <optional>
 
 using namespace llvm;
@@ -4420,6 +4421,114 @@ static SDValue lowerConstant(SDValue Op, SelectionDAG &DAG,
   return SDValue();
 }
 
+// Expand a CRC step into shifts, ANDs and XORs. The step is linear over
+// GF(2): once the data has been combined with the CRC register into DataWidth
+// bits T, the new register is the shifted old one XORed with the step of
+// every set bit of T, which is a constant (a column of the step matrix). Only
+// generic nodes are used, so the expansion works lane-wise on vectors.
+static SDValue expandCRCStepToXorNetwork(const CRCDescriptor &Desc,
+                                         SDValue Data, SDValue Crc,
+                                         const SDLoc &DL, SelectionDAG &DAG) {
+  EVT VT = Crc.getValueType();
+  unsigned W = Desc.Width;
+  unsigned K = Desc.DataWidth;
+  auto getShiftAmount = [&](unsigned Amount) {
+    return DAG.getShiftAmountConstant(Amount, VT, DL);
+  };
+  auto getLowBits = [&](SDValue V, unsigned Bits) {
+    if (Bits >= VT.getScalarSizeInBits())
+      return V;
+    return DAG.getNode(ISD::AND, DL, VT, V,
+                       DAG.getConstant(maskTrailingOnes<uint64_t>(Bits), DL, VT));
+  };
+
+  Data = DAG.getZExtOrTrunc(Data, DL, VT);
+  Crc = getLowBits(Crc, W);
+
+  SDValue T, Result;
+  if (Desc.RefIn) {
+    T = DAG.getNode(ISD::XOR, DL, VT, Crc, Data);
+    // Steps over at least as many bits as VT has (fused steps on RV32) shift
+    // the whole register out.
+    Result = K < VT.getScalarSizeInBits()
+                 ? DAG.getNode(ISD::SRL, DL, VT, Crc, getShiftAmount(K))
+                 : DAG.getConstant(0, DL, VT);
+  } else {
+    T = DAG.getNode(ISD::SRL, DL, VT, Crc, getShiftAmount(W - K));
+    T = DAG.getNode(ISD::XOR, DL, VT, T, Data);
+    Result = getLowBits(DAG.getNode(ISD::SHL, DL, VT, Crc, getShiftAmount(K)), W);
+  }
+  T = getLowBits(T, K);
+
+  APInt NoCrc(W, 0);
+  SDValue Zero = DAG.getConstant(0, DL, VT);
+  SDValue One = DAG.getConstant(1, DL, VT);
+  for (unsigned I = 0; I < K; ++I) {
+    APInt Column = evaluateCRCStep(Desc, APInt::getOneBitSet(64, I), NoCrc);
+    // -((T >> I) & 1) selects the column when bit I of T is set.
+    SDValue Bit = DAG.getNode(ISD::SRL, DL, VT, T, getShiftAmount(I));
+    Bit = DAG.getNode(ISD::AND, DL, VT, Bit, One);
+    SDValue Select = DAG.getNode(ISD::SUB, DL, VT, Zero, Bit);
+    SDValue Term = DAG.getNode(
+        ISD::AND, DL, VT, Select,
+        DAG.getConstant(Column.getZExtValue(), DL, VT));
+    Result = DAG.getNode(ISD::XOR, DL, VT, Result, Term);
+  }
+
+  return Result;
+}
+
+// Expand a CRC step into two carry-less multiplications (Barrett reduction),
+// the computation PSEUDO_CRC is selected to, but built from clmul intrinsics
+// so that it works for every data width getCRCBarrettConstants accepts. Only
+// the low DataWidth bits of Data and the low Width bits of Crc are read.
+static SDValue expandCRCStepToClmul(const CRCDescriptor &Desc, SDValue Data,
+                                    SDValue Crc, const SDLoc &DL,
+                                    SelectionDAG &DAG) {
+  EVT VT = Crc.getValueType();
+  const CRCBarrettConstants Consts = getCRCBarrettConstants(Desc);
+  unsigned W = Desc.Width;
+  unsigned K = Desc.DataWidth;
+  auto getShiftAmount = [&](unsigned Amount) {
+    return DAG.getShiftAmountConstant(Amount, VT, DL);
+  };
+  auto getLowBits = [&](SDValue V, unsigned Bits) {
+    return DAG.getNode(ISD::AND, DL, VT, V,
+                       DAG.getConstant(maskTrailingOnes<uint64_t>(Bits), DL, VT));
+  };
+  auto getClmul = [&](SDValue LHS, SDValue RHS) {
+    return DAG.getNode(ISD::INTRINSIC_WO_CHAIN, DL, VT,
+                       DAG.getTargetConstant(Intrinsic::riscv_clmul, DL, VT),
+                       LHS, RHS);
+  };
+
+  Crc = getLowBits(Crc, W);
+  SDValue Quotient = DAG.getConstant(Consts.Quotient, DL, VT);
+  SDValue Poly = DAG.getConstant(Consts.Poly, DL, VT);
+  if (Desc.RefIn) {
+    // t = (crc ^ data) mod x^K
+    // q = clmul(t, quotient) mod x^K
+    // crc' = (crc >> K) ^ (clmul(q, poly) >> K)
+    SDValue T = getLowBits(DAG.getNode(ISD::XOR, DL, VT, Crc, Data), K);
+    SDValue Q = getLowBits(getClmul(T, Quotient), K);
+    SDValue Reduced =
+        DAG.getNode(ISD::SRL, DL, VT, getClmul(Q, Poly), getShiftAmount(K));
+    return DAG.getNode(ISD::XOR, DL, VT,
+                       DAG.getNode(ISD::SRL, DL, VT, Crc, getShiftAmount(K)),
+                       Reduced);
+  }
+  // t = ((crc >> (W - K)) ^ data) mod x^K
+  // q = clmul(t, quotient) >> K
+  // crc' = ((crc << K) ^ clmul(q, poly)) mod x^W
+  SDValue T = DAG.getNode(ISD::SRL, DL, VT, Crc, getShiftAmount(W - K));
+  T = getLowBits(DAG.getNode(ISD::XOR, DL, VT, T, Data), K);
+  SDValue Q = DAG.getNode(ISD::SRL, DL, VT, getClmul(T, Quotient),
+                          getShiftAmount(K));
+  SDValue Shifted = DAG.getNode(ISD::SHL, DL, VT, Crc, getShiftAmount(K));
+  return getLowBits(
+      DAG.getNode(ISD::XOR, DL, VT, Shifted, getClmul(Q, Poly)), W);
+}
+
 static SDValue LowerCRC8(SDValue Op, SelectionDAG &DAG, const RISCVSubtarget &Subtarget){
   SDValue N1=Op.getOperand(1);
   SDValue N2=Op.getOperand(2);
@@ -6759,6 +6868,16 @@ SDValue RISCVTargetLowering::LowerINTRINSIC_WO_CHAIN(SDValue Op,
     break; // Don't custom lower most intrinsics.
   case Intrinsic::riscv_crc_petar:{
     errs() << "Hi from lower intrinsic without chain (Intrinsic::riscv_crc_petar)!\n";
+    // PSEUDO_CRC is selected to carry-less multiplications. Targets without
+    // them (e.g. generic rv64gc distribution builds) get the step as shifts
+    // and XORs instead.
+    if (!Subtarget.hasStdExtZbc() && !Subtarget.hasStdExtZbkc()) {
+      SDValue Data = DAG.getZExtOrTrunc(Op.getOperand(1), DL, XLenVT);
+      SDValue Crc = DAG.getZExtOrTrunc(Op.getOperand(2), DL, XLenVT);
+      SDValue Step = expandCRCStepToXorNetwork(getCRCU8Descriptor(), Data,
+                                               Crc, DL, DAG);
+      return DAG.getZExtOrTrunc(Step, DL, Op.getValueType());
+    }
     SDValue N1=Op.getOperand(1);
     SDValue N2=Op.getOperand(2);
     SDValue N1_ext=DAG.getAnyExtOrTrunc(N1, DL, MVT::i64);
@@ -6766,6 +6885,24 @@ SDValue RISCVTargetLowering::LowerINTRINSIC_WO_CHAIN(SDValue Op,
     SDValue PSEUDO_CRC_NODE=DAG.getNode(RISCVISD::PSEUDO_CRC, DL, MVT::i64, N1_ext, N2_ext);
     return DAG.getAnyExtOrTrunc(PSEUDO_CRC_NODE, DL, MVT::i16);
   }
+  case Intrinsic::riscv_crc_petar_vector:
+    return expandCRCStepToXorNetwork(getCRCU8Descriptor(), Op.getOperand(1),
+                                     Op.getOperand(2), DL, DAG);
+  case Intrinsic::riscv_crc_petar_wide: {
+    // One step over all bits of the data: a single pair of carry-less
+    // multiplications instead of one pair per byte, as long as the product
+    // fits in a register.
+    CRCDescriptor Desc = getCRCU8Descriptor();
+    Desc.DataWidth = Op.getOperand(1).getValueSizeInBits();
+    SDValue Data = DAG.getZExtOrTrunc(Op.getOperand(1), DL, XLenVT);
+    SDValue Crc = DAG.getZExtOrTrunc(Op.getOperand(2), DL, XLenVT);
+    bool HasClmul = Subtarget.hasStdExtZbc() || Subtarget.hasStdExtZbkc();
+    SDValue Step =
+        HasClmul && Desc.Width + Desc.DataWidth < Subtarget.getXLen()
+            ? expandCRCStepToClmul(Desc, Data, Crc, DL, DAG)
+            : expandCRCStepToXorNetwork(Desc, Data, Crc, DL, DAG);
+    return DAG.getZExtOrTrunc(Step, DL, Op.getValueType());
+  }
   case Intrinsic::thread_pointer: {
     EVT PtrVT = getPointerTy(DAG.getDataLayout());
     return DAG.getRegister(RISCV::X4, PtrVT);
@@ -12242,6 +12379,15 @@ SDValue RISCVTargetLowering::PerformDAGCombine(SDNode *N,
       return SDValue(N, 0);
     break;
   }
+  case RISCVISD::PSEUDO_CRC: {
+    // Only the low DataWidth bits of the data and the low Width bits of the
+    // CRC register are read, so the extensions around them can go away.
+    const CRCDescriptor &Desc = getCRCU8Descriptor();
+    if (SimplifyDemandedLowBitsHelper(0, Desc.DataWidth) ||
+        SimplifyDemandedLowBitsHelper(1, Desc.Width))
+      return SDValue(N, 0);
+    break;
+  }
   case RISCVISD::FMV_X_ANYEXTH:
   case RISCVISD::FMV_X_ANYEXTW_RV64: {
     SDLoc DL(N);
@@ -13020,6 +13166,12 @@ void RISCVTargetLowering::computeKnownBitsForTargetNode(const SDValue Op,
     Known.Zero.setBitsFrom(LowBits);
     break;
   }
+  case RISCVISD::PSEUDO_CRC: {
+    KnownBits Data = DAG.computeKnownBits(Op.getOperand(0), Depth + 1);
+    KnownBits Crc = DAG.computeKnownBits(Op.getOperand(1), Depth + 1);
+    Known = computeKnownBitsForCRCStep(getCRCU8Descriptor(), Data, Crc);
+    break;
+  }
   case RISCVISD::BREV8:
   case RISCVISD::ORC_B: {
     // FIXME: This is based on the non-ratified Zbp GREV and GORC where a
@@ -13059,6 +13211,21 @@ void RISCVTargetLowering::computeKnownBitsForTargetNode(const SDValue Op,
       if (BitWidth > 17)
         Known.Zero.setBitsFrom(17);
       break;
+    case Intrinsic::riscv_crc_petar: {
+      KnownBits Data = DAG.computeKnownBits(Op.getOperand(1), Depth + 1);
+      KnownBits Crc = DAG.computeKnownBits(Op.getOperand(2), Depth + 1);
+      Known = computeKnownBitsForCRCStep(getCRCU8Descriptor(), Data,
+                                         Crc.zextOrTrunc(BitWidth));
+      break;
+    }
+    case Intrinsic::riscv_crc_petar_wide: {
+      KnownBits Data = DAG.computeKnownBits(Op.getOperand(1), Depth + 1);
+      KnownBits Crc = DAG.computeKnownBits(Op.getOperand(2), Depth + 1);
+      CRCDescriptor Desc = getCRCU8Descriptor();
+      Desc.DataWidth = Data.getBitWidth();
+      Known = computeKnownBitsForCRCStep(Desc, Data, Crc.zextOrTrunc(BitWidth));
+      break;
+    }
     }
     break;
   }
@@ -0,0 +1,277 @@
+// Throughput of buffer level CRC-16/ARC over a sweep of buffer sizes, next to
+// the memcpy bandwidth of the same buffers as a roofline.
+//
+// Variants:
+//   bytestep   crc_buffer.c as written, one crcu8 call per byte
+//   table      crc_buffer.c with the steps lowered to table lookups
+//   intrinsic  crc_buffer.c with the steps lowered to the CRC intrinsic
+//              (riscv64 only)
+//   runtime    __crc_update, what -crc-lowering=libcall calls, including
+//              finding the context of the descriptor
+//   slicing, pclmul, vpclmul, zbc
+//              the kernels of the CRC runtime, called directly; the carry-less
+//              multiplication ones fold the buffer
+// The crc_buffer variants are linked in by run_buffer_sweep.sh and skipped
+// when missing (they are weak), so are the kernels the CPU does not support.
+//
+// Every point is measured for at least min_time seconds, the best of five
+// such rounds is reported. Buffers up to 1 MiB are reused and stay in the
+// caches; the 1 GiB buffer is mmap-backed and faulted in before timing.
+// For every folding kernel the buffer size from which it beats the fastest
+// variant that does not fold (bytestep, table, intrinsic, slicing, and
+// runtime unless the runtime picked that kernel itself) is found by
+// bisection between the sizes of the sweep.
+//
+// Usage: ./buffer_sweep [max size in bytes] [min time per point in seconds]
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "../../implementations/crc-runtime/crc_internal.h"
+
+unsigned short crc_buffer_bytestep(const unsigned char *buf, size_t len, unsigned short crc) __attribute__((weak));
+unsigned short crc_buffer_table(const unsigned char *buf, size_t len, unsigned short crc) __attribute__((weak));
+unsigned short crc_buffer_intrinsic(const unsigned char *buf, size_t len, unsigned short crc) __attribute__((weak));
+
+// CRC-16/ARC, the CRC crcu8 computes
+static const struct crc_descriptor crc16_arc = {16, 1, 1, 0x8005, 0, 0};
+static struct crc_context context;
+
+static const size_t sizes[] = {16, 64, 1500, 4096, 65536, 1 << 20, 1 << 30};
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+#define ROUNDS 5
+
+struct variant {
+  const char *name;
+  // Returns a value that depends on the result, so the call is not deleted
+  uint64_t (*run)(const struct variant *v, unsigned char *buf, size_t len);
+  unsigned short (*crc_buffer)(const unsigned char *, size_t, unsigned short);
+  crc_kernel_fn kernel;
+  int folds;
+  // What a folding kernel has to beat
+  int baseline;
+};
+
+static unsigned char *destination;
+
+static uint64_t run_memcpy(const struct variant *v, unsigned char *buf,
+                           size_t len) {
+  (void)v;
+  memcpy(destination, buf, len);
+  __asm__ volatile("" : : "r"(destination) : "memory");
+  return destination[len - 1];
+}
+
+static uint64_t run_crc_buffer(const struct variant *v, unsigned char *buf,
+                               size_t len) {
+  return v->crc_buffer(buf, len, 0);
+}
+
+static uint64_t run_runtime(const struct variant *v, unsigned char *buf,
+                            size_t len) {
+  (void)v;
+  return __crc_update(&crc16_arc, 0, buf, len);
+}
+
+static uint64_t run_kernel(const struct variant *v, unsigned char *buf,
+                           size_t len) {
+  return v->kernel(&context, 0, buf, len);
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double min_time = 0.1;
+
+// Bytes per second of v on buf[0..len), the best of ROUNDS rounds.
+static double measure(const struct variant *v, unsigned char *buf, size_t len) {
+  double best = 0;
+  uint64_t sink = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    // The clock is read after batches of calls that grow until min_time
+    // is reached, so reading it costs nothing even for 16 bytes
+    long calls = 0, batch = 1;
+    double start = now_seconds(), elapsed;
+    do {
+      for (long i = 0; i < batch; i++)
+        sink += v->run(v, buf, len);
+      calls += batch;
+      batch *= 2;
+      elapsed = now_seconds() - start;
+    } while (elapsed < min_time);
+    double rate = (double)len * calls / elapsed;
+    if (rate > best)
+      best = rate;
+    // One call of a large buffer is already longer than min_time
+    if (elapsed > 10 * min_time)
+      break;
+  }
+  __asm__ volatile("" : : "r"(sink));
+  return best;
+}
+
+// The best rate of the baselines of the folding kernel folding, from rates
+// when given, otherwise measured on buf[0..len). The runtime is not a baseline
+// of the kernel it dispatches to.
+static double best_baseline_rate(const struct variant *variants, int n,
+                                 const struct variant *folding,
+                                 const double *rates, unsigned char *buf,
+                                 size_t len) {
+  double best = 0;
+  for (int v = 0; v < n; v++) {
+    if (!variants[v].baseline ||
+        (variants[v].run == run_runtime &&
+         !strcmp(__crc_kernel_name(&crc16_arc), folding->name)))
+      continue;
+    double rate = rates ? rates[v] : measure(&variants[v], buf, len);
+    if (rate > best)
+      best = rate;
+  }
+  return best;
+}
+
+static unsigned char *allocate(size_t len) {
+  unsigned char *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return NULL;
+  for (size_t i = 0; i < len; i++)
+    p[i] = (unsigned char)(i * 0x9e3779b1u >> 24);
+  return p;
+}
+
+static int kernel_usable(const char *name) {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (!strcmp(name, "pclmul"))
+    return __builtin_cpu_supports("pclmul");
+  if (!strcmp(name, "vpclmul"))
+    return __builtin_cpu_supports("pclmul") &&
+           __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("vpclmulqdq");
+#endif
+  // The runtime knows whether the hart has Zbc, only use it when it picked it
+  if (!strcmp(name, "zbc"))
+    return !strcmp(__crc_kernel_name(&crc16_arc), "zbc");
+  return !strcmp(name, "slicing");
+}
+
+int main(int argc, char **argv) {
+  size_t max_size = argc > 1 ? strtoull(argv[1], NULL, 0) : (size_t)1 << 30;
+  if (argc > 2)
+    min_time = atof(argv[2]);
+  if (max_size < 16 || min_time <= 0) {
+    fprintf(stderr, "Usage: %s [max size in bytes] [min time per point in seconds]\n", argv[0]);
+    return 1;
+  }
+
+  __crc_context_init(&context, &crc16_arc);
+
+  struct variant candidates[] = {
+      {"memcpy", run_memcpy, NULL, NULL, 0, 0},
+      {"bytestep", run_crc_buffer, crc_buffer_bytestep, NULL, 0, 1},
+      {"table", run_crc_buffer, crc_buffer_table, NULL, 0, 1},
+      {"intrinsic", run_crc_buffer, crc_buffer_intrinsic, NULL, 0, 1},
+      {"runtime", run_runtime, NULL, NULL, 0, 1},
+      {"slicing", run_kernel, NULL, __crc_kernel_slicing, 0, 1},
+#if defined(__x86_64__)
+      {"pclmul", run_kernel, NULL, __crc_kernel_pclmul, 1, 0},
+      {"vpclmul", run_kernel, NULL, __crc_kernel_vpclmul, 1, 0},
+#endif
+#if defined(__riscv) && __riscv_xlen == 64
+      {"zbc", run_kernel, NULL, __crc_kernel_zbc, 1, 0},
+#endif
+  };
+  struct variant variants[sizeof(candidates) / sizeof(candidates[0])];
+  int n = 0;
+  for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+    const struct variant *c = &candidates[i];
+    if (c->run == run_crc_buffer && !c->crc_buffer)
+      continue;
+    if (c->run == run_kernel && !kernel_usable(c->name))
+      continue;
+    variants[n++] = *c;
+  }
+
+  size_t largest = 0;
+  for (size_t s = 0; s < NUM_SIZES && sizes[s] <= max_size; s++)
+    largest = sizes[s];
+  unsigned char *buf = allocate(largest);
+  destination = allocate(largest);
+  if (!buf || !destination) {
+    fprintf(stderr, "Could not map two buffers of %zu bytes\n", largest);
+    return 1;
+  }
+
+  // All variants have to agree before any of them is timed
+  for (int v = 1; v < n; v++) {
+    if (variants[v].run == run_memcpy)
+      continue;
+    uint64_t expected = __crc_update_bitwise(&crc16_arc, 0, buf, 4096);
+    uint64_t got = variants[v].run(&variants[v], buf, 4096);
+    if (got != expected) {
+      fprintf(stderr, "%s computes %llu instead of %llu\n", variants[v].name,
+              (unsigned long long)got, (unsigned long long)expected);
+      return 1;
+    }
+  }
+
+  printf("GB/s%12s", "size");
+  for (int v = 0; v < n; v++)
+    printf(" %10s", variants[v].name);
+  printf("\n");
+
+  double rates[NUM_SIZES][sizeof(candidates) / sizeof(candidates[0])];
+  size_t measured = 0;
+  for (size_t s = 0; s < NUM_SIZES && sizes[s] <= max_size; s++, measured++) {
+    printf("%16zu", sizes[s]);
+    for (int v = 0; v < n; v++) {
+      rates[s][v] = measure(&variants[v], buf, sizes[s]);
+      printf(" %10.3f", rates[s][v] / 1e9);
+      fflush(stdout);
+    }
+    printf("\n");
+  }
+
+  // Where folding starts to pay off against the variants that do not fold
+  for (int v = 0; v < n; v++) {
+    if (!variants[v].folds)
+      continue;
+    size_t s = 0;
+    while (s < measured &&
+           rates[s][v] <= best_baseline_rate(variants, n, &variants[v], rates[s], NULL, 0))
+      s++;
+    if (s == measured) {
+      printf("%s never beats the variants that do not fold up to %zu bytes\n",
+             variants[v].name, sizes[measured - 1]);
+      continue;
+    }
+    if (s == 0) {
+      printf("%s beats the variants that do not fold at all sizes, from %zu bytes\n",
+             variants[v].name, sizes[0]);
+      continue;
+    }
+    size_t low = sizes[s - 1], high = sizes[s];
+    while (high - low > 1 && high - low > low / 16) {
+      size_t mid = low + (high - low) / 2;
+      if (measure(&variants[v], buf, mid) >
+          best_baseline_rate(variants, n, &variants[v], NULL, buf, mid))
+        high = mid;
+      else
+        low = mid;
+    }
+    printf("%s beats the variants that do not fold from %zu bytes\n", variants[v].name,
+           high);
+  }
+
+  return 0;
+}
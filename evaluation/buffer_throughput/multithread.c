@@ -0,0 +1,247 @@
+// Aggregate throughput of buffer level CRC-16/ARC on 1 to N threads, alone
+// and next to a co-runner that keeps evicting the caches, the way CRCs are
+// computed in a busy process rather than in a clean microbenchmark.
+//
+// Lowerings:
+//   bitwise  crc_buffer.c as written, one crcu8 call per byte, no tables
+//   table    crc_buffer.c with the steps lowered to lookups in a 512 byte
+//            table by the CRC passes (linked in by run_multithread.sh)
+//   slicing  slicing-by-8 kernel of the CRC runtime, 16 KiB of tables
+//   clmul    the carry-less multiplication kernel of the CRC runtime
+//            (pclmul or zbc), no tables
+// Lowerings that are not available are skipped.
+//
+// Every thread computes the CRC of its own buffer over and over for the
+// duration of a point; the co-runner streams stores through a buffer larger
+// than the last level cache. The threads are pinned to CPUs of their own and
+// the co-runner to the last CPU the process may run on, so it only competes
+// for the caches and memory, not for time on the cores; points that leave no
+// CPU free for the co-runner are only run alone. Reported are the aggregate
+// GB/s, the scaling efficiency (aggregate / (threads * one thread alone))
+// and, with the co-runner, the slowdown against the same point without it.
+// The per byte cost of a table lowering under cache pressure is what a cost
+// model choosing between the lowerings has to assume, not the clean one.
+//
+// Usage: ./multithread [max threads] [buffer size] [seconds per point] [co-runner MiB]
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../implementations/crc-runtime/crc_internal.h"
+
+unsigned short crc_buffer_bitwise(const unsigned char *buf, size_t len, unsigned short crc) __attribute__((weak));
+unsigned short crc_buffer_table(const unsigned char *buf, size_t len, unsigned short crc) __attribute__((weak));
+
+// CRC-16/ARC, the CRC crcu8 computes
+static const struct crc_descriptor crc16_arc = {16, 1, 1, 0x8005, 0, 0};
+static struct crc_context context;
+
+struct lowering {
+  const char *name;
+  unsigned short (*crc_buffer)(const unsigned char *, size_t, unsigned short);
+  crc_kernel_fn kernel;
+};
+
+static uint64_t run_lowering(const struct lowering *l, const unsigned char *buf,
+                             size_t len, uint64_t crc) {
+  if (l->crc_buffer)
+    return l->crc_buffer(buf, len, (unsigned short)crc);
+  return l->kernel(&context, crc, buf, len);
+}
+
+static int stop;
+
+struct worker {
+  pthread_t thread;
+  const struct lowering *lowering;
+  unsigned char *buf;
+  size_t len;
+  uint64_t bytes;
+  uint64_t crc;
+};
+
+static void *crc_worker(void *arg) {
+  struct worker *w = arg;
+  // The workers are next to each other in one array, the results are only
+  // stored once so that they do not share the cache lines while running
+  uint64_t crc = 0, bytes = 0;
+  while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+    crc = run_lowering(w->lowering, w->buf, w->len, crc);
+    bytes += w->len;
+  }
+  w->bytes = bytes;
+  w->crc = crc;
+  return NULL;
+}
+
+static unsigned char *thrash_buf;
+static size_t thrash_len;
+
+// Store to every cache line of a buffer larger than the caches, over and over
+static void *co_runner(void *arg) {
+  (void)arg;
+  for (unsigned char value = 0; !__atomic_load_n(&stop, __ATOMIC_RELAXED); value++)
+    for (size_t i = 0; i < thrash_len; i += 64)
+      thrash_buf[i] = value;
+  return NULL;
+}
+
+// CPUs the process may run on, CPU 0 when they are not known
+static int cpus[CPU_SETSIZE];
+static int num_cpus;
+
+static void pin(pthread_t thread, int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(thread, sizeof(set), &set))
+    fprintf(stderr, "Could not pin a thread to CPU %d\n", cpu);
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Aggregate bytes per second of threads workers running l for seconds. With
+// thrash, threads has to leave the last CPU free for the co-runner.
+static double run_point(const struct lowering *l, int threads, size_t len,
+                        double seconds, int thrash) {
+  struct worker *workers = calloc(threads, sizeof(*workers));
+  pthread_t thrasher;
+
+  __atomic_store_n(&stop, 0, __ATOMIC_RELAXED);
+  if (thrash) {
+    pthread_create(&thrasher, NULL, co_runner, NULL);
+    pin(thrasher, cpus[num_cpus - 1]);
+  }
+  for (int t = 0; t < threads; t++) {
+    workers[t].lowering = l;
+    workers[t].len = len;
+    workers[t].buf = aligned_alloc(64, (len + 63) / 64 * 64);
+    for (size_t i = 0; i < len; i++)
+      workers[t].buf[i] = (unsigned char)((i + t) * 0x9e3779b1u >> 24);
+  }
+
+  double start = now_seconds();
+  for (int t = 0; t < threads; t++) {
+    pthread_create(&workers[t].thread, NULL, crc_worker, &workers[t]);
+    pin(workers[t].thread, cpus[t % num_cpus]);
+  }
+  struct timespec duration = {(time_t)seconds,
+                              (long)((seconds - (time_t)seconds) * 1e9)};
+  nanosleep(&duration, NULL);
+  __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+
+  uint64_t bytes = 0;
+  for (int t = 0; t < threads; t++) {
+    pthread_join(workers[t].thread, NULL);
+    bytes += workers[t].bytes;
+    free(workers[t].buf);
+  }
+  double elapsed = now_seconds() - start;
+  if (thrash)
+    pthread_join(thrasher, NULL);
+  free(workers);
+  return bytes / elapsed;
+}
+
+int main(int argc, char **argv) {
+  cpu_set_t allowed;
+  if (!sched_getaffinity(0, sizeof(allowed), &allowed))
+    for (int c = 0; c < CPU_SETSIZE; c++)
+      if (CPU_ISSET(c, &allowed))
+        cpus[num_cpus++] = c;
+  if (!num_cpus)
+    cpus[num_cpus++] = 0;
+  int max_threads = argc > 1 ? atoi(argv[1]) : num_cpus;
+  size_t len = argc > 2 ? strtoull(argv[2], NULL, 0) : 4096;
+  double seconds = argc > 3 ? atof(argv[3]) : 0.5;
+  size_t thrash_mib = argc > 4 ? strtoull(argv[4], NULL, 0) : 64;
+  if (max_threads < 1 || len < 1 || seconds <= 0) {
+    fprintf(stderr, "Usage: %s [max threads] [buffer size] [seconds per point] [co-runner MiB]\n", argv[0]);
+    return 1;
+  }
+
+  __crc_context_init(&context, &crc16_arc);
+  thrash_len = thrash_mib << 20;
+  thrash_buf = thrash_len ? malloc(thrash_len) : NULL;
+  if (thrash_len && !thrash_buf) {
+    fprintf(stderr, "Could not allocate %zu MiB for the co-runner\n", thrash_mib);
+    return 1;
+  }
+  if (thrash_buf)
+    memset(thrash_buf, 1, thrash_len);
+
+  static unsigned char check[4096];
+  for (size_t i = 0; i < sizeof(check); i++)
+    check[i] = (unsigned char)(i * 0x9e3779b1u >> 24);
+
+  struct lowering candidates[] = {
+      {"bitwise", crc_buffer_bitwise, NULL},
+      {"table", crc_buffer_table, NULL},
+      {"slicing", NULL, __crc_kernel_slicing},
+#if defined(__x86_64__)
+      {"clmul", NULL, __crc_kernel_pclmul},
+#elif defined(__riscv) && __riscv_xlen == 64
+      {"clmul", NULL, __crc_kernel_zbc},
+#endif
+  };
+
+  printf("%zu byte buffers, %.2f s per point, co-runner %zu MiB, %d CPUs\n",
+         len, seconds, thrash_mib, num_cpus);
+  printf("%-8s %7s %12s %10s %14s %10s\n", "lowering", "threads", "GB/s",
+         "scaling", "GB/s thrashed", "slowdown");
+
+  for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+    const struct lowering *l = &candidates[i];
+    if (!l->crc_buffer && !l->kernel)
+      continue;
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (l->kernel == __crc_kernel_pclmul && !__builtin_cpu_supports("pclmul"))
+      continue;
+#elif defined(__riscv) && __riscv_xlen == 64
+    // The runtime knows whether the hart has Zbc, only use it when it picked it
+    if (l->kernel == __crc_kernel_zbc &&
+        strcmp(__crc_kernel_name(&crc16_arc), "zbc"))
+      continue;
+#endif
+    if (run_lowering(l, check, sizeof(check), 0) !=
+        __crc_update_bitwise(&crc16_arc, 0, check, sizeof(check))) {
+      fprintf(stderr, "%s computes a wrong CRC\n", l->name);
+      return 1;
+    }
+
+    double single = 0;
+    // 1, 2, 4, ... threads and max_threads
+    for (int threads = 1; threads <= max_threads;
+         threads = threads < max_threads && threads * 2 > max_threads
+                       ? max_threads
+                       : threads * 2) {
+      double rate = run_point(l, threads, len, seconds, 0);
+      if (threads == 1)
+        single = rate;
+      printf("%-8s %7d %12.3f %9.1f%%", l->name, threads, rate / 1e9,
+             100 * rate / (threads * single));
+      if (thrash_len && threads < num_cpus) {
+        double thrashed = run_point(l, threads, len, seconds, 1);
+        printf(" %14.3f %9.2fx", thrashed / 1e9, rate / thrashed);
+      } else if (thrash_len) {
+        printf(" %14s %10s", "no free CPU", "-");
+      }
+      printf("\n");
+      fflush(stdout);
+    }
+  }
+
+  free(thrash_buf);
+  return 0;
+}
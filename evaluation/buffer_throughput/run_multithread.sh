@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# Build and run multithread: crc_buffer.c of evaluation/fuzzing (the crcu8 of
+# evaluation/time_measurement called once per byte) as written and with the
+# CRC steps lowered by the CRC passes, linked with the CRC runtime.
+#   bitwise    clang as written
+#   table      -crc-opt-intrinsic -crc-lowering=table
+#
+# Usage: ./run_multithread.sh [max threads] [buffer size] [seconds per point] [co-runner MiB]
+#
+# Environment:
+#   LLVM_BIN       directory with clang and opt built with the CRC passes
+#                  (default: ../../../build/bin)
+#   TARGET         x86-64 (default) or riscv64, which runs under qemu
+#   RISCV_SYSROOT  sysroot of the riscv64 toolchain (default: /usr/riscv64-linux-gnu)
+#   QEMU_RISCV     qemu user mode emulator (default: qemu-riscv64)
+#   RISCV_CPU      qemu CPU model with the Zbc extension (default: rv64,zbc=true)
+#   OPT_LEVEL      optimization level of the variants (default: -O2)
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+LLVM_BIN=${LLVM_BIN:-$DIR/../../../build/bin}
+TARGET=${TARGET:-x86-64}
+OPT_LEVEL=${OPT_LEVEL:--O2}
+. "$DIR/../../scripts/crc_build_common.sh"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+FLAGS="$(target_flags "$TARGET")"
+SOURCE="$DIR/../fuzzing/crc_buffer.c"
+objects=()
+
+"$LLVM_BIN/clang" $FLAGS $OPT_LEVEL -c "$SOURCE" -Dcrc_buffer=crc_buffer_bitwise \
+    -o "$WORK/bitwise.o" || exit 1
+objects+=("$WORK/bitwise.o")
+
+crc_variant "$TARGET" "$WORK" "$SOURCE" crc_buffer table \
+    "-crc-opt-intrinsic -crc-lowering=table" "$CRC_LOOP_PIPELINE"
+
+build_crc_runtime_objects "$TARGET" "$WORK/runtime" || exit 1
+
+"$LLVM_BIN/clang" $FLAGS -O2 "$DIR/multithread.c" "${objects[@]}" \
+    "$WORK"/runtime/*.o -o "$WORK/multithread" -lpthread || exit 1
+$(target_runner "$TARGET") "$WORK/multithread" "$@"
@@ -0,0 +1,69 @@
+// Generates a synthetic LLVM IR module for the compile time benchmark: a
+// given number of functions, each a single basic block with a given number
+// of instructions. The instructions are a mix of arithmetic, shifts and byte
+// loads, so the function passes have something to match on in every
+// instruction, but none of them forms a pattern the passes rewrite; the
+// crcu8 the CRC passes look for is linked in by run_compile_time.sh.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+static void emitFunction(FILE *f, long index, long instructions){
+    fprintf(f, "define i32 @synthetic_%ld(ptr %%p, i32 %%a, i32 %%b) {\n", index);
+    fprintf(f, "entry:\n");
+    fprintf(f, "  %%v0 = add i32 %%a, %%b\n");
+    fprintf(f, "  %%v1 = xor i32 %%v0, %%a\n");
+
+    long v=2;
+    for(long i=2;i<instructions;i++, v++){
+        long x=v-1, y=v-2;
+        switch(v%8){
+        case 0: fprintf(f, "  %%v%ld = add i32 %%v%ld, %%v%ld\n", v, x, y); break;
+        case 1: fprintf(f, "  %%v%ld = mul i32 %%v%ld, %ld\n", v, x, 2*v+1); break;
+        case 2: fprintf(f, "  %%v%ld = xor i32 %%v%ld, %%v%ld\n", v, x, y); break;
+        case 3: fprintf(f, "  %%v%ld = shl i32 %%v%ld, 3\n", v, x); break;
+        case 4: fprintf(f, "  %%v%ld = lshr i32 %%v%ld, 5\n", v, x); break;
+        case 5: fprintf(f, "  %%v%ld = or i32 %%v%ld, %%v%ld\n", v, x, y); break;
+        case 6:
+            // A byte load from an offset that depends on the chain, so
+            // neighbouring loads are never consecutive
+            fprintf(f, "  %%g%ld = getelementptr i8, ptr %%p, i32 %%v%ld\n", v, x);
+            fprintf(f, "  %%l%ld = load i8, ptr %%g%ld, align 1\n", v, v);
+            fprintf(f, "  %%v%ld = zext i8 %%l%ld to i32\n", v, v);
+            i+=2;
+            break;
+        case 7: fprintf(f, "  %%v%ld = and i32 %%v%ld, %%v%ld\n", v, x, y); break;
+        }
+    }
+    fprintf(f, "  ret i32 %%v%ld\n}\n\n", v-1);
+}
+
+int main(int argc, char **argv){
+    if(argc<3){
+        cerr << "Usage: " << argv[0] << " <functions> <instructions per function> [output.ll]\n";
+        exit(1);
+    }
+
+    long functions=atol(argv[1]);
+    long instructions=atol(argv[2]);
+    if(functions<1 || instructions<2){
+        cerr << "Please provide at least one function with at least two instructions!\n";
+        exit(1);
+    }
+
+    FILE *f=argc>3 ? fopen(argv[3], "w") : stdout;
+    if(f==NULL){
+        cerr << "Could not open " << argv[3] << "\n";
+        exit(1);
+    }
+
+    for(long i=0;i<functions;i++)
+        emitFunction(f, i, instructions);
+
+    if(f!=stdout)
+        fclose(f);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#!/bin/bash
+
+# Compile time scalability benchmark of the recognition passes. For every
+# module size in CASES a synthetic module is generated with generate_module
+# (functions x instructions per function, every function one basic block),
+# the crcu8 of evaluation/time_measurement is linked in, and every pass in
+# PASSES is run on it alone under opt -time-passes -track-memory. The time
+# and memory opt reports for the pass, the total of the pass pipeline and the
+# peak RSS of opt are written to <output>.csv.
+#
+# A pass that does per function work only should scale linearly with the
+# number of functions; compare the time per function across the sizes.
+#
+# Usage: ./run_compile_time.sh [output prefix]
+#
+# Environment:
+#   LLVM_BIN  directory with opt, clang and llvm-link built with the CRC passes
+#             (default: ../../../build/bin)
+#   CASES     module sizes as functions x instructions
+#             (default: "1000x16 10000x16 100000x16 1000x1024 10x100000")
+#   PASSES    passes to time (default: "crc-recognition aggressive-instcombine
+#             expression-optimizer")
+#   OPT_FLAGS extra opt flags (default: -crc-opt)
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+OUTPUT=${1:-compile_time_results}
+LLVM_BIN=${LLVM_BIN:-$DIR/../../../build/bin}
+CASES=${CASES:-"1000x16 10000x16 100000x16 1000x1024 10x100000"}
+PASSES=${PASSES:-"crc-recognition aggressive-instcombine expression-optimizer"}
+OPT_FLAGS=${OPT_FLAGS--crc-opt}
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Name of the pass in the -time-passes report
+pass_class() {
+    case $1 in
+        crc-recognition) echo RecognizingCRCPass ;;
+        aggressive-instcombine) echo AggressiveInstCombinePass ;;
+        expression-optimizer) echo ExpressionOptimizerPass ;;
+        *) echo "$1" ;;
+    esac
+}
+
+# Print "wall seconds,memory bytes" of the row of a pass in a -time-passes
+# report. The percentages are dropped, then the last number with a decimal
+# point is the wall time and a number without one is the memory.
+report_row() {
+    sed 's/([^)]*)//g' "$1" | awk -v name="$2" '
+        /Pass execution timing report/ { in_passes = 1 }
+        /LLVM IR Parsing/ { in_passes = 0 }
+        in_passes {
+            wall = ""; mem = ""; i = 1
+            for (; i <= NF && $i ~ /^[0-9.]+$/; i++)
+                if ($i ~ /\./) wall = $i; else mem = $i
+            if (i == NF && $i == name) { print wall "," mem; exit }
+        }'
+}
+
+g++ -O2 "$DIR/generate_module.cpp" -o "$WORK/generate_module" || exit 1
+"$LLVM_BIN/clang" -O0 -Xclang -disable-O0-optnone -S -emit-llvm \
+    "$DIR/../time_measurement/unoptimized_crc.c" -Dmain=unused_main -o "$WORK/crcu8.ll" || exit 1
+
+if [ -x /usr/bin/time ]; then
+    TIME="/usr/bin/time -f %M -o $WORK/rss"
+else
+    TIME=""
+fi
+
+echo "pass,functions,instructions,status,pass_wall_s,pass_mem_bytes,total_wall_s,peak_rss_kb,pass_us_per_function" > "$OUTPUT.csv"
+
+for size in $CASES; do
+    functions=${size%x*}
+    instructions=${size#*x}
+    module="$WORK/synthetic_$size.bc"
+    "$WORK/generate_module" "$functions" "$instructions" "$WORK/synthetic.ll" &&
+    "$LLVM_BIN/llvm-link" "$WORK/synthetic.ll" "$WORK/crcu8.ll" -o "$module" || exit 1
+    rm -f "$WORK/synthetic.ll"
+
+    for pass in $PASSES; do
+        status=ok; pass_time=","; total=""; rss=""; per_function=""
+        rm -f "$WORK/rss"
+        if $TIME "$LLVM_BIN/opt" $OPT_FLAGS -passes="$pass" -time-passes -track-memory \
+                -disable-output "$module" 2>"$WORK/report"; then
+            pass_time=$(report_row "$WORK/report" "$(pass_class "$pass")")
+            [ -z "$pass_time" ] && { status="pass not in report"; pass_time=","; }
+            total=$(awk '/Total Execution Time/ { print $4; exit }' "$WORK/report")
+            [ -f "$WORK/rss" ] && rss=$(tail -n 1 "$WORK/rss")
+            wall=${pass_time%,*}
+            [ -n "$wall" ] && per_function=$(awk -v w="$wall" -v f="$functions" 'BEGIN { printf "%.3f", w * 1e6 / f }')
+        else
+            status="opt failed"
+        fi
+
+        echo "$pass $size: $status, ${pass_time%,*} s, $per_function us/function"
+        echo "$pass,$functions,$instructions,\"$status\",$pass_time,$total,$rss,$per_function" >> "$OUTPUT.csv"
+    done
+    rm -f "$module"
+done
+
+echo "Results written to $OUTPUT.csv"
@@ -0,0 +1,144 @@
+#!/bin/bash
+
+# End-to-end evaluation on CoreMark, whose crcu8 is the CRC the passes
+# recognize (crcu16 and crcu32 call it two and four times). CoreMark is built
+# once per mode and target
+#   baseline            every source as written
+#   ir                  core_util.c + the IR level CRC optimization
+#   table               core_util.c + the intrinsic, lowered to table lookups
+#   intrinsic           core_util.c + the intrinsic, with the steps of crcu16
+#                       and crcu32 fused into one wide step (RISC-V only)
+#   intrinsic-unfused   the same without the fusion (-crc-fuse-steps=false)
+# and the iterations/sec it reports are written to <output.csv>, with the
+# speedup over the baseline of the same target. CoreMark checks the CRCs of
+# its list, matrix and state results itself; a run it does not validate is
+# reported as such. Whether crcu8 was recognized and how many step chains
+# were fused is read from the optimization remarks of the CRC passes. The binaries and build logs are
+# kept in <output.csv>.build.
+#
+# Usage: ./run_coremark.sh <coremark checkout> [output.csv]
+#
+# Environment:
+#   LLVM_BIN       directory with clang and opt built with the CRC passes
+#                  (default: ../../../build/bin)
+#   TARGETS        targets to run (default: "x86-64 riscv64")
+#   MODES          modes to build (default: all of the above)
+#   PORT_DIR       CoreMark port (default: posix, or linux in older checkouts)
+#   ITERATIONS     CoreMark iterations, 0 lets it pick (default: 0)
+#   OPT_LEVEL      optimization level of all sources (default: -O2)
+#   RISCV_SYSROOT  sysroot of the riscv64 toolchain (default: /usr/riscv64-linux-gnu)
+#   QEMU_RISCV     qemu user mode emulator (default: qemu-riscv64)
+#   RISCV_CPU      qemu CPU model with the Zbc extension (default: rv64,zbc=true)
+
+if [ $# -lt 1 ] || [ ! -f "$1/core_util.c" ]; then
+    echo "Usage: $0 <coremark checkout> [output.csv]"
+    exit 1
+fi
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+COREMARK="$(cd "$1" && pwd)"
+OUTPUT=${2:-coremark_results.csv}
+LLVM_BIN=${LLVM_BIN:-$DIR/../../../build/bin}
+TARGETS=${TARGETS:-"x86-64 riscv64"}
+MODES=${MODES:-"baseline ir table intrinsic intrinsic-unfused"}
+ITERATIONS=${ITERATIONS:-0}
+OPT_LEVEL=${OPT_LEVEL:--O2}
+. "$DIR/../../scripts/crc_build_common.sh"
+if [ -z "$PORT_DIR" ]; then
+    PORT_DIR=$COREMARK/posix
+    [ -f "$PORT_DIR/core_portme.c" ] || PORT_DIR=$COREMARK/linux
+fi
+
+WORK="$OUTPUT.build"
+mkdir -p "$WORK" || exit 1
+
+# Compile core_util.c through the CRC passes: unoptimized IR, recognition of
+# crcu8, then the usual optimizations (which inline crcu8 into crcu16 and
+# crcu32) and a second run of the pass over the result, which fuses the steps
+# or lowers them to table lookups.
+# build_core_util <mode> <flags> <output object>
+build_core_util() {
+    local mode=$1 flags=$2 out=$3
+    local first second
+    case $mode in
+        ir) first="-crc-opt"; second="" ;;
+        table) first="-crc-opt-intrinsic"; second="-crc-lowering=table" ;;
+        intrinsic) first="-crc-opt-intrinsic"; second="" ;;
+        intrinsic-unfused) first="-crc-opt-intrinsic"; second="-crc-fuse-steps=false" ;;
+    esac
+    "$LLVM_BIN/clang" $flags $CFLAGS -O0 -Xclang -disable-O0-optnone -S -emit-llvm \
+        "$COREMARK/core_util.c" -o "$out.ll" &&
+    "$LLVM_BIN/opt" -S $first -passes=crc-recognition -pass-remarks=crc-recognition \
+        "$out.ll" -o "$out.crc.ll" &&
+    "$LLVM_BIN/opt" -S "$OPT_LEVEL" "$out.crc.ll" -o "$out.opt.ll" &&
+    "$LLVM_BIN/opt" -S $second -passes=crc-recognition -pass-remarks=crc-recognition \
+        "$out.opt.ll" -o "$out.final.ll" &&
+    "$LLVM_BIN/clang" $flags "$OPT_LEVEL" -c "$out.final.ll" -o "$out"
+}
+
+# build <mode> <target> <output binary>
+build() {
+    local mode=$1 target=$2 out=$3
+    local flags
+    flags="$(target_flags "$target")"
+
+    local sources="core_list_join.c core_main.c core_matrix.c core_state.c"
+    local objects=()
+    for src in $sources "$PORT_DIR/core_portme.c"; do
+        [[ $src == /* ]] || src=$COREMARK/$src
+        objects+=("$out.$(basename "$src" .c).o")
+        "$LLVM_BIN/clang" $flags $CFLAGS "$OPT_LEVEL" -c "$src" -o "${objects[-1]}" || return 1
+    done
+    objects+=("$out.core_util.o")
+    if [ "$mode" = baseline ]; then
+        "$LLVM_BIN/clang" $flags $CFLAGS "$OPT_LEVEL" -c "$COREMARK/core_util.c" \
+            -o "$out.core_util.o" || return 1
+    else
+        build_core_util "$mode" "$flags" "$out.core_util.o" || return 1
+    fi
+    "$LLVM_BIN/clang" $flags "${objects[@]}" -o "$out" -lrt
+}
+
+echo "mode,optimization,target,status,iterations_per_sec,speedup,crcu8_recognized,fused_chains" > "$OUTPUT"
+
+for target in $TARGETS; do
+    baseline_rate=""
+    for mode in $MODES; do
+        bin="$WORK/$mode-$target"
+        # The same FLAGS_STR in every mode, so that only the rate differs
+        CFLAGS="-I$COREMARK -I$PORT_DIR -DFLAGS_STR=\"$OPT_LEVEL\" -DITERATIONS=$ITERATIONS -DPERFORMANCE_RUN=1"
+        status=ok; rate=""; speedup=""; recognized=""; fused=""
+        if [[ $mode == intrinsic* ]] && [ "$target" != riscv64 ]; then
+            status="intrinsic lowering is RISC-V only"
+        elif ! build "$mode" "$target" "$bin" >"$bin.log" 2>&1; then
+            status="build failed, see $bin.log"
+        else
+            if [ "$mode" != baseline ]; then
+                recognized=no
+                grep -q "remark: .*CRC in crcu8 lowered" "$bin.log" && recognized=yes
+                fused=$(grep -c "remark: .*CRC steps in .* fused into one step" "$bin.log")
+            fi
+            result=$($(target_runner "$target") "$bin" 2>&1)
+            rate=$(echo "$result" | awk -F: '/^Iterations\/Sec/ { gsub(/ /, "", $2); print $2 }')
+            if [ -z "$rate" ]; then
+                status="run failed"
+            elif ! echo "$result" | grep -q "Correct operation validated"; then
+                status="not validated"
+            fi
+        fi
+
+        [ "$mode" = baseline ] && [ "$status" = ok ] && baseline_rate=$rate
+        if [ "$status" = ok ] && [ -n "$baseline_rate" ]; then
+            speedup=$(awk -v r="$rate" -v b="$baseline_rate" 'BEGIN { printf "%.3f", r / b }')
+        fi
+
+        if [ "$status" = ok ]; then
+            echo "$mode $OPT_LEVEL $target: $rate iterations/sec, speedup ${speedup:-?}"
+        else
+            echo "$mode $OPT_LEVEL $target: $status"
+        fi
+        echo "$mode,$OPT_LEVEL,$target,\"$status\",$rate,$speedup,$recognized,$fused" >> "$OUTPUT"
+    done
+done
+
+echo "Results written to $OUTPUT"
@@ -0,0 +1,21 @@
+// CRC-16/MODBUS of Modbus RTU frames after the bit by bit routine of the
+// Modbus over serial line specification: the reflected polynomial 0x8005
+// (0xa001), the register starting at 0xffff.
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint16_t crc16_modbus(uint16_t crc, const uint8_t *buf, size_t len) {
+  for (size_t pos = 0; pos < len; pos++) {
+    crc ^= (uint16_t)buf[pos];
+    for (int i = 8; i != 0; i--) {
+      if ((crc & 0x0001) != 0) {
+        crc >>= 1;
+        crc ^= 0xa001;
+      } else {
+        crc >>= 1;
+      }
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,20 @@
+// CRC-16/XMODEM after the bit by bit routine of the XMODEM/YMODEM protocol
+// reference (Forsberg): the byte is xored into the top of the register and
+// the polynomial 0x1021 shifted in MSB-first.
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint16_t crc16_xmodem(uint16_t crc, const unsigned char *ptr, size_t count) {
+  while (count-- > 0) {
+    crc = crc ^ (uint16_t)*ptr++ << 8;
+    int i = 8;
+    do {
+      if (crc & 0x8000)
+        crc = crc << 1 ^ 0x1021;
+      else
+        crc = crc << 1;
+    } while (--i);
+  }
+  return crc;
+}
@@ -0,0 +1,19 @@
+// CRC-32/ISO-HDLC bit by bit, the reflected Ethernet polynomial 0xedb88320
+// shifted in LSB-first, after crc32a of Hacker's Delight: the mask trick
+// instead of a branch, and the register inverted on entry and exit like
+// zlib's crc32().
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint32_t crc32_bitwise(uint32_t crc, const unsigned char *message, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc = crc ^ message[i];
+    for (int j = 7; j >= 0; j--) {
+      uint32_t mask = -(crc & 1);
+      crc = (crc >> 1) ^ (0xedb88320 & mask);
+    }
+  }
+  return ~crc;
+}
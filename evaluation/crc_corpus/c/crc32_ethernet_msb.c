@@ -0,0 +1,16 @@
+// The Ethernet polynomial 0x04c11db7 MSB-first, bit by bit, the way the CRC
+// of MPEG-2 transport stream sections and of bzip2 blocks is computed. The
+// register is not inverted here: starting from 0xffffffff gives
+// CRC-32/MPEG-2, inverting the result on top of that CRC-32/BZIP2.
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint32_t crc32_ethernet_msb(uint32_t crc, const unsigned char *data, size_t len) {
+  while (len--) {
+    crc ^= (uint32_t)*data++ << 24;
+    for (int i = 0; i < 8; i++)
+      crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+  return crc;
+}
@@ -0,0 +1,19 @@
+// CRC-7/MMC of SD/MMC commands the way card drivers without the Linux table
+// compute it: bit by bit, MSB-first, the 7-bit register in the low bits and
+// the polynomial 0x09.
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint8_t crc7_mmc(uint8_t crc, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    uint8_t d = data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc <<= 1;
+      if ((d & 0x80) ^ (crc & 0x80))
+        crc ^= 0x09;
+      d <<= 1;
+    }
+  }
+  return crc & 0x7f;
+}
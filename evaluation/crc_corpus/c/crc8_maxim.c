@@ -0,0 +1,22 @@
+// CRC-8/MAXIM-DOW of the Dallas/Maxim 1-Wire bus (ROM codes, DS18B20
+// scratchpad) after the bit by bit routine of Maxim application note 27 and
+// the OneWire library: the reflected polynomial 0x31 (0x8c), a data bit
+// shifted in per iteration. The original takes (addr, len) and starts from
+// zero; here the register is passed in like the other buffer functions.
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint8_t crc8_maxim(uint8_t crc, const uint8_t *addr, size_t len) {
+  while (len--) {
+    uint8_t inbyte = *addr++;
+    for (uint8_t i = 8; i; i--) {
+      uint8_t mix = (crc ^ inbyte) & 0x01;
+      crc >>= 1;
+      if (mix)
+        crc ^= 0x8c;
+      inbyte >>= 1;
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,34 @@
+// CRC-16/ARC with its lookup table computed at compile time by a constexpr
+// function into a std::array, the modern C++ form of linux_crc16.c. The
+// table is still a constant global in the IR, so it looks the same to the
+// CRC passes as a table written out by hand.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+constexpr std::array<std::uint16_t, 256> make_table(std::uint16_t poly) {
+  std::array<std::uint16_t, 256> table{};
+  for (unsigned n = 0; n < 256; ++n) {
+    std::uint16_t c = static_cast<std::uint16_t>(n);
+    for (int k = 0; k < 8; ++k)
+      c = (c & 1) ? static_cast<std::uint16_t>((c >> 1) ^ poly)
+                  : static_cast<std::uint16_t>(c >> 1);
+    table[n] = c;
+  }
+  return table;
+}
+
+constexpr auto crc16_table = make_table(0xa001);
+
+} // namespace
+
+extern "C" std::uint16_t constexpr_crc16_arc(std::uint16_t crc,
+                                             const unsigned char *buf,
+                                             std::size_t len) {
+  for (std::size_t i = 0; i < len; ++i)
+    crc = static_cast<std::uint16_t>((crc >> 8) ^ crc16_table[(crc ^ buf[i]) & 0xff]);
+  return crc;
+}
@@ -0,0 +1,68 @@
+// A CRC class template in the style of Boost.CRC's crc_optimal and of the
+// header-only CRC libraries built after it: the Rocksoft parameters are
+// template arguments, the register is a member and process_bytes() shifts
+// the data in bit by bit. Only what the corpus uses is here.
+
+#ifndef CRC_CORPUS_CRC_TEMPLATE_HPP
+#define CRC_CORPUS_CRC_TEMPLATE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace crc_corpus {
+
+template <typename Register, unsigned Bits, Register TruncPoly,
+          Register InitRem, Register FinalXor, bool Reflect>
+class basic_crc {
+public:
+  static_assert(Bits <= sizeof(Register) * 8, "register too narrow");
+
+  explicit basic_crc(Register init_rem = InitRem) : rem_(init_rem) {}
+
+  void process_byte(unsigned char byte) {
+    if (Reflect) {
+      rem_ ^= byte;
+      for (int i = 0; i < 8; ++i)
+        rem_ = (rem_ & 1) ? (rem_ >> 1) ^ reflected_poly() : rem_ >> 1;
+    } else {
+      rem_ ^= static_cast<Register>(byte) << (Bits - 8);
+      for (int i = 0; i < 8; ++i)
+        rem_ = (rem_ & high_bit()) ? (rem_ << 1) ^ TruncPoly : rem_ << 1;
+      rem_ &= mask();
+    }
+  }
+
+  void process_bytes(const void *buffer, std::size_t byte_count) {
+    auto *p = static_cast<const unsigned char *>(buffer);
+    for (auto *end = p + byte_count; p != end; ++p)
+      process_byte(*p);
+  }
+
+  Register get_interim_remainder() const { return rem_; }
+  Register checksum() const { return (rem_ ^ FinalXor) & mask(); }
+
+private:
+  static constexpr Register mask() {
+    return Bits == sizeof(Register) * 8 ? static_cast<Register>(~Register(0))
+                                        : static_cast<Register>((Register(1) << Bits) - 1);
+  }
+  static constexpr Register high_bit() { return Register(1) << (Bits - 1); }
+  static constexpr Register reflected_poly() {
+    Register result = 0;
+    for (unsigned i = 0; i < Bits; ++i)
+      if (TruncPoly >> i & 1)
+        result |= Register(1) << (Bits - 1 - i);
+    return result;
+  }
+
+  Register rem_;
+};
+
+// The register of a previous call continues the CRC, so init and final xor
+// are left to the caller like in the C functions of the corpus.
+using crc_32_register = basic_crc<std::uint32_t, 32, 0x04c11db7, 0, 0, true>;
+using crc_ccitt_register = basic_crc<std::uint16_t, 16, 0x1021, 0, 0, false>;
+
+} // namespace crc_corpus
+
+#endif
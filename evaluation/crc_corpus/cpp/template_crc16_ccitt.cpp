@@ -0,0 +1,12 @@
+// The CCITT polynomial 0x1021 MSB-first through the crc_template.hpp class
+// template, the C++ counterpart of linux_crc_itu_t.c and crc16_xmodem.c.
+
+#include "crc_template.hpp"
+
+extern "C" std::uint16_t template_crc16_ccitt(std::uint16_t crc,
+                                              const unsigned char *buf,
+                                              std::size_t len) {
+  crc_corpus::crc_ccitt_register ccitt(crc);
+  ccitt.process_bytes(buf, len);
+  return ccitt.get_interim_remainder();
+}
@@ -0,0 +1,13 @@
+// CRC-32/ISO-HDLC through the crc_template.hpp class template, reflected,
+// with the inversion on entry and exit done around it the way zlib's crc32()
+// does, so the result is comparable with the C implementations.
+
+#include "crc_template.hpp"
+
+extern "C" std::uint32_t template_crc32(std::uint32_t crc,
+                                        const unsigned char *buf,
+                                        std::size_t len) {
+  crc_corpus::crc_32_register crc32(~crc);
+  crc32.process_bytes(buf, len);
+  return ~crc32.get_interim_remainder();
+}
@@ -0,0 +1,179 @@
+#!/bin/bash
+
+# Recognition coverage of the CRC passes on the real-world CRC implementations
+# of corpus.txt: for every implementation and target, which of them the
+# passes recognize and how much faster they get. Every implementation is
+# built as
+#   reference   clang $OPT_LEVEL without the CRC passes
+#   crc-O0      the passes run on the unoptimized IR (the flow of the other
+#               evaluations), then $OPT_LEVEL
+#   crc-O2      the passes run on the IR clang -O2 produces, then $OPT_LEVEL
+# and linked with ../gcc_comparison/crc_harness.c (which checks the CRC of
+# "123456789" against the catalogue first) and the CRC runtime. An
+# implementation counts as recognized at a level when the passes report the
+# CRCCost remark for any function of its source, and as accelerated when it
+# is also at least $ACCELERATED times faster than the reference. Variants
+# whose checksum differs from the reference are reported as checksum
+# mismatches and count as neither.
+#
+# The passes run in two steps: first with PASS_FLAGS, which recognizes the
+# CRCs and lowers the loops over buffers to calls of the CRC runtime, then
+# with the step lowering of the target for the steps that are left over
+# (table lookups on x86-64, the CRC intrinsic on riscv64 with Zbc). Because
+# the second step lowers every step that is left over, the first one also
+# replaces the lookups of CRC-16/ARC tables with CRC steps on x86-64
+# (-crc-table-steps), which the passes only do for RISC-V otherwise.
+#
+# Usage: ./run_corpus_coverage.sh [output.csv] [repetitions]
+#
+# Environment:
+#   LLVM_BIN       directory with clang and opt built with the CRC passes
+#                  (default: ../../../build/bin)
+#   TARGETS        targets to run (default: "x86-64 riscv64")
+#   CORPUS         list of implementations (default: corpus.txt next to this script)
+#   OPT_LEVEL      optimization level of all variants (default: -O2)
+#   PASS_FLAGS     options of the recognizing step
+#                  (default: -crc-opt-intrinsic -crc-lowering=libcall)
+#   ACCELERATED    speedup from which a recognized CRC counts as accelerated
+#                  (default: 1.1)
+#   RISCV_SYSROOT  sysroot of the riscv64 toolchain (default: /usr/riscv64-linux-gnu)
+#   QEMU_RISCV     qemu user mode emulator (default: qemu-riscv64)
+#   RISCV_CPU      qemu CPU model with the Zbc extension (default: rv64,zbc=true)
+#   INPUTS         inputs file (default: evaluation/time_measurement/inputs.txt)
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+ROOT="$(cd "$DIR/../.." && pwd)"
+OUTPUT=${1:-corpus_coverage.csv}
+REPETITIONS=${2:-15}
+LLVM_BIN=${LLVM_BIN:-$DIR/../../../build/bin}
+TARGETS=${TARGETS:-"x86-64 riscv64"}
+CORPUS=${CORPUS:-$DIR/corpus.txt}
+OPT_LEVEL=${OPT_LEVEL:--O2}
+PASS_FLAGS=${PASS_FLAGS:-"-crc-opt-intrinsic -crc-lowering=libcall"}
+ACCELERATED=${ACCELERATED:-1.1}
+INPUTS=${INPUTS:-$DIR/../time_measurement/inputs.txt}
+. "$ROOT/scripts/crc_build_common.sh"
+
+WORK="$OUTPUT.build"
+mkdir -p "$WORK" || exit 1
+
+# Lowering of the CRC steps that are not part of a lowered loop
+target_step_lowering() {
+    case $1 in
+        x86-64) echo "-crc-lowering=table" ;;
+        riscv64) echo "-crc-lowering=intrinsic" ;;
+    esac
+}
+
+# Compile the source of an implementation to an object. For the crc
+# variants, prints the functions the passes lowered a CRC in.
+# compile <variant> <target> <source> <output object>
+compile() {
+    local variant=$1 target=$2 src=$3 out=$4
+    local flags
+    flags="$(target_flags "$target") -Dmain=corpus_main"
+    case $variant in
+        reference)
+            "$LLVM_BIN/clang" $flags $OPT_LEVEL -c "$src" -o "$out" ;;
+        crc-O0|crc-O2)
+            if [ "$variant" = crc-O0 ]; then
+                "$LLVM_BIN/clang" $flags -O0 -Xclang -disable-O0-optnone -S -emit-llvm \
+                    "$src" -o "$out.ll" || return 1
+            else
+                "$LLVM_BIN/clang" $flags -O2 -S -emit-llvm "$src" -o "$out.ll" || return 1
+            fi
+            "$LLVM_BIN/opt" -S $PASS_FLAGS -crc-table-steps -passes="$CRC_LOOP_PIPELINE" \
+                -pass-remarks=crc-recognition "$out.ll" -o "$out.crc.ll" 2>"$out.remarks" &&
+            "$LLVM_BIN/opt" -S $(target_step_lowering "$target") -passes=crc-recognition \
+                -pass-remarks=crc-recognition "$out.crc.ll" -o "$out.lowered.ll" 2>>"$out.remarks" &&
+            "$LLVM_BIN/clang" $flags $OPT_LEVEL -c "$out.lowered.ll" -o "$out" || return 1
+            sed -n 's/.*CRC in \([^ ]*\) lowered.*/\1/p' "$out.remarks" | sort -u | paste -sd' ' ;;
+    esac
+}
+
+echo "implementation,source,target,variant,status,recognized,lowered_functions,cycles_byte_median,ns_call_median,speedup,checksum" > "$OUTPUT"
+
+for target in $TARGETS; do
+    flags="$(target_flags "$target")"
+
+    # The CRC runtime, which the libcall lowering calls
+    runtime="$WORK/runtime-$target"
+    build_crc_runtime_objects "$target" "$runtime" ||
+        { echo "$target: the CRC runtime could not be built, skipped"; continue; }
+
+    declare -A recognized_count=() accelerated_count=()
+    total=0
+
+    while read -r name src fn kind init check _; do
+        [ -z "$name" ] || [[ $name == \#* ]] && continue
+        total=$((total + 1))
+        kind_flag="-DCRC_KIND_$(echo "$kind" | tr a-z A-Z)"
+        check_flags=""
+        [ -n "$check" ] && check_flags="-DCRC_INIT=$init -DCRC_CHECK=$check"
+        harness="$WORK/harness-$name-$target.o"
+        "$LLVM_BIN/clang" $flags $OPT_LEVEL -DCRC_FUNCTION="$fn" $kind_flag $check_flags \
+            -c "$DIR/../gcc_comparison/crc_harness.c" -o "$harness" 2>"$harness.log"
+
+        reference=""; reference_cycles=""
+        for variant in reference crc-O0 crc-O2; do
+            obj="$WORK/$name-$variant-$target.o"
+            bin="$WORK/$name-$variant-$target"
+            status=ok; lowered=""; recognized=""; cycles=""; ns=""; checksum=""; speedup=""
+            # C++ sources are linked with clang++ for their runtime library
+            linker="$LLVM_BIN/clang"
+            [[ $src == *.cpp ]] && linker="$LLVM_BIN/clang++"
+            if ! lowered=$(compile "$variant" "$target" "$ROOT/$src" "$obj" 2>"$obj.log") ||
+               ! "$linker" $flags "$harness" "$obj" "$runtime"/*.o -o "$bin" -lm 2>>"$obj.log"; then
+                status="build failed, see $obj.log"
+            else
+                result=$($(target_runner "$target") "$bin" "$INPUTS" "$REPETITIONS" 2>&1)
+                if [ $? -ne 0 ]; then
+                    # The last line says why, e.g. a wrong check value
+                    reason=$(echo "$result" | tail -n 1)
+                    status="run failed: ${reason//\"/\'}"
+                else
+                    ns=$(echo "$result" | awk '/ns\/call/ { print $5 }')
+                    cycles=$(echo "$result" | awk '/cycles\/byte/ { print $5 }')
+                    checksum=$(echo "$result" | awk '/checksum/ { print $2 }')
+                    [ "$variant" = reference ] && reference=$checksum
+                    [ "$checksum" != "$reference" ] && status="checksum mismatch"
+                fi
+            fi
+
+            # Speedup over the reference, in cycles where the harness could
+            # read them and in time otherwise
+            time=${cycles:-$ns}; unit="cycles/byte"
+            [ -z "$cycles" ] && unit="ns/call"
+            if [ "$variant" = reference ]; then
+                reference_cycles=$time
+            elif [ "$status" = ok ] && [ -n "$reference_cycles" ] && [ -n "$time" ]; then
+                speedup=$(awk -v r="$reference_cycles" -v t="$time" 'BEGIN { if (t > 0) printf "%.2f", r / t }')
+            fi
+
+            if [ "$variant" != reference ]; then
+                recognized=no
+                [ -n "$lowered" ] && [ "$status" = ok ] && recognized=yes
+                if [ "$recognized" = yes ]; then
+                    recognized_count[$variant]=$((${recognized_count[$variant]:-0} + 1))
+                    awk -v s="${speedup:-0}" -v a="$ACCELERATED" 'BEGIN { exit !(s >= a) }' &&
+                        accelerated_count[$variant]=$((${accelerated_count[$variant]:-0} + 1))
+                fi
+            fi
+
+            if [ "$status" = ok ]; then
+                echo "$name $target $variant: ${time:-?} $unit${recognized:+, recognized $recognized}${speedup:+, speedup ${speedup}x}"
+            else
+                echo "$name $target $variant: $status"
+            fi
+            echo "$name,$src,$target,$variant,\"$status\",$recognized,\"$lowered\",$cycles,$ns,$speedup,$checksum" >> "$OUTPUT"
+        done
+    done < "$CORPUS"
+
+    for variant in crc-O0 crc-O2; do
+        echo "$target $variant: ${recognized_count[$variant]:-0} of $total implementations recognized," \
+             "${accelerated_count[$variant]:-0} accelerated (speedup >= $ACCELERATED)"
+    done
+    unset recognized_count accelerated_count
+done
+
+echo "Results written to $OUTPUT"
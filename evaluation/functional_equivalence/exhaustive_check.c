@@ -0,0 +1,264 @@
+// Exhaustive functional equivalence check of crcu8.
+//
+// crcu8(unsigned char, unsigned short) has only 2^24 inputs, so instead of
+// comparing the outputs for a sample of random pairs every input is checked,
+// in process and on all cores. Each implementation linked in is compared
+// with an independent bit by bit model of CRC-16/ARC:
+//   crcu8_original   unoptimized_crc.c as written
+//   crcu8_optimized  optimized_crc.c as written
+//   crcu8_pass_ir    unoptimized_crc.c after the IR level CRC optimization
+//   crcu8_pass_intr  unoptimized_crc.c after the intrinsic based optimization
+// Implementations that are not linked in (they are weak) are skipped, see
+// run_exhaustive_check.sh for how the variants are built.
+//
+// Wider steps can not be checked exhaustively: crcu16 and crcu32 of
+// unoptimized_crc.c, as written (crcu16_original, crcu32_original) and after
+// the passes, which fuse them into one 16 and 32 bit step with the intrinsic
+// based optimization. A CRC step is linear over GF(2) in the data and the
+// register, so for those check_linear_step compares the step with the model
+// on a basis (every single input bit) and then tests the linearity of the
+// implementation itself on random pairs of inputs.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+unsigned short crcu8_original(unsigned char data, unsigned short crc) __attribute__((weak));
+unsigned short crcu8_optimized(unsigned char data, unsigned short crc) __attribute__((weak));
+unsigned short crcu8_pass_ir(unsigned char data, unsigned short crc) __attribute__((weak));
+unsigned short crcu8_pass_intr(unsigned char data, unsigned short crc) __attribute__((weak));
+unsigned short crcu16_original(unsigned short data, unsigned short crc) __attribute__((weak));
+unsigned short crcu16_pass_ir(unsigned short data, unsigned short crc) __attribute__((weak));
+unsigned short crcu16_pass_intr(unsigned short data, unsigned short crc) __attribute__((weak));
+unsigned short crcu32_original(unsigned int data, unsigned short crc) __attribute__((weak));
+unsigned short crcu32_pass_ir(unsigned int data, unsigned short crc) __attribute__((weak));
+unsigned short crcu32_pass_intr(unsigned int data, unsigned short crc) __attribute__((weak));
+
+typedef unsigned short (*crcu8_fn)(unsigned char, unsigned short);
+
+struct candidate {
+  const char *name;
+  crcu8_fn fn;
+  // Smallest mismatching input (data << 16 | crc), or 1 << 24 if none
+  uint32_t first_mismatch;
+  pthread_mutex_t lock;
+};
+
+// Parameters of a CRC step in the Rocksoft model, without init and xorout,
+// which a single step does not apply.
+struct crc_step_descriptor {
+  unsigned width;
+  unsigned data_width;
+  int reflected;
+  uint64_t poly;
+};
+
+static const struct crc_step_descriptor crc16_arc = {16, 8, 1, 0x8005};
+// crcu16 and crcu32: CRC-16/ARC over two and four bytes, least significant
+// byte first, which is one reflected step over 16 and 32 data bits
+static const struct crc_step_descriptor crc16_arc_u16 = {16, 16, 1, 0x8005};
+static const struct crc_step_descriptor crc16_arc_u32 = {16, 32, 1, 0x8005};
+
+static uint64_t width_mask(unsigned width) {
+  return width == 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+}
+
+static uint64_t reflect(uint64_t value, unsigned width) {
+  uint64_t result = 0;
+  for (unsigned i = 0; i < width; i++)
+    if (value >> i & 1)
+      result |= (uint64_t)1 << (width - 1 - i);
+  return result;
+}
+
+// Bit by bit model of one step, written from the descriptor rather than from
+// any of the implementations under test.
+static uint64_t model_step(const struct crc_step_descriptor *desc,
+                           uint64_t data, uint64_t crc) {
+  uint64_t mask = width_mask(desc->width);
+  crc &= mask;
+  if (desc->reflected) {
+    uint64_t poly = reflect(desc->poly, desc->width);
+    for (unsigned i = 0; i < desc->data_width; i++) {
+      int carry = (crc ^ data >> i) & 1;
+      crc >>= 1;
+      if (carry)
+        crc ^= poly;
+    }
+  } else {
+    for (unsigned i = desc->data_width; i-- > 0;) {
+      int carry = (crc >> (desc->width - 1) ^ data >> i) & 1;
+      crc = crc << 1 & mask;
+      if (carry)
+        crc ^= desc->poly;
+    }
+  }
+  return crc;
+}
+
+static struct candidate candidates[4];
+static unsigned num_candidates;
+static unsigned short expected[1 << 16][256];
+
+struct worker {
+  pthread_t thread;
+  uint32_t begin, end; // range of crc values
+};
+
+static void *check_range(void *arg) {
+  const struct worker *w = arg;
+  for (uint32_t crc = w->begin; crc < w->end; crc++)
+    for (uint32_t data = 0; data < 256; data++)
+      expected[crc][data] = model_step(&crc16_arc, data, crc);
+
+  for (unsigned c = 0; c < num_candidates; c++) {
+    struct candidate *cand = &candidates[c];
+    for (uint32_t crc = w->begin; crc < w->end; crc++) {
+      for (uint32_t data = 0; data < 256; data++) {
+        if (cand->fn(data, crc) == expected[crc][data])
+          continue;
+        pthread_mutex_lock(&cand->lock);
+        if ((data << 16 | crc) < cand->first_mismatch)
+          cand->first_mismatch = data << 16 | crc;
+        pthread_mutex_unlock(&cand->lock);
+        break;
+      }
+    }
+  }
+  return NULL;
+}
+
+// Compare step with the model of desc on every single input bit, which
+// determines a linear step completely, and check that step is linear on
+// samples random pairs of inputs. Returns the number of failures.
+static unsigned check_linear_step(const char *name,
+                                  const struct crc_step_descriptor *desc,
+                                  uint64_t (*step)(uint64_t data, uint64_t crc),
+                                  unsigned samples) {
+  unsigned failures = 0;
+  uint64_t data_mask = width_mask(desc->data_width);
+  uint64_t crc_mask = width_mask(desc->width);
+
+  if (step(0, 0) != 0)
+    failures++;
+  for (unsigned i = 0; i < desc->data_width; i++)
+    failures += step((uint64_t)1 << i, 0) != model_step(desc, (uint64_t)1 << i, 0);
+  for (unsigned i = 0; i < desc->width; i++)
+    failures += step(0, (uint64_t)1 << i) != model_step(desc, 0, (uint64_t)1 << i);
+
+  uint64_t state = 0x9e3779b97f4a7c15u;
+  for (unsigned i = 0; i < samples; i++) {
+    uint64_t r[4];
+    for (int j = 0; j < 4; j++) {
+      // splitmix64
+      uint64_t z = (state += 0x9e3779b97f4a7c15u);
+      z = (z ^ z >> 30) * 0xbf58476d1ce4e5b9u;
+      z = (z ^ z >> 27) * 0x94d049bb133111ebu;
+      r[j] = z ^ z >> 31;
+    }
+    uint64_t d1 = r[0] & data_mask, c1 = r[1] & crc_mask;
+    uint64_t d2 = r[2] & data_mask, c2 = r[3] & crc_mask;
+    failures += (step(d1 ^ d2, c1 ^ c2) ^ step(d1, c1) ^ step(d2, c2)) != 0;
+  }
+
+  printf("%-16s %s (%u basis vectors, %u random pairs)\n", name,
+         failures ? "NOT EQUIVALENT" : "equivalent",
+         desc->width + desc->data_width, samples);
+  return failures;
+}
+
+// fn as a step of check_linear_step
+#define LINEAR_STEP(fn, data_type)                                             \
+  static uint64_t fn##_step(uint64_t data, uint64_t crc) {                     \
+    return fn((data_type)data, crc);                                           \
+  }
+
+LINEAR_STEP(crcu8_original, unsigned char)
+LINEAR_STEP(crcu16_original, unsigned short)
+LINEAR_STEP(crcu16_pass_ir, unsigned short)
+LINEAR_STEP(crcu16_pass_intr, unsigned short)
+LINEAR_STEP(crcu32_original, unsigned int)
+LINEAR_STEP(crcu32_pass_ir, unsigned int)
+LINEAR_STEP(crcu32_pass_intr, unsigned int)
+
+int main(int argc, char **argv) {
+  long threads = argc > 1 ? atol(argv[1]) : sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads < 1)
+    threads = 1;
+
+  const struct { const char *name; crcu8_fn fn; } linked[] = {
+      {"crcu8_original", crcu8_original},
+      {"crcu8_optimized", crcu8_optimized},
+      {"crcu8_pass_ir", crcu8_pass_ir},
+      {"crcu8_pass_intr", crcu8_pass_intr},
+  };
+  for (unsigned i = 0; i < sizeof(linked) / sizeof(linked[0]); i++) {
+    if (!linked[i].fn)
+      continue;
+    struct candidate *cand = &candidates[num_candidates++];
+    cand->name = linked[i].name;
+    cand->fn = linked[i].fn;
+    cand->first_mismatch = 1 << 24;
+    pthread_mutex_init(&cand->lock, NULL);
+  }
+  if (!num_candidates) {
+    fprintf(stderr, "No crcu8 implementation is linked in\n");
+    return 2;
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  struct worker *workers = calloc(threads, sizeof(*workers));
+  for (long t = 0; t < threads; t++) {
+    workers[t].begin = (uint32_t)((1u << 16) * t / threads);
+    workers[t].end = (uint32_t)((1u << 16) * (t + 1) / threads);
+    pthread_create(&workers[t].thread, NULL, check_range, &workers[t]);
+  }
+  for (long t = 0; t < threads; t++)
+    pthread_join(workers[t].thread, NULL);
+  free(workers);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  int failed = 0;
+  for (unsigned c = 0; c < num_candidates; c++) {
+    const struct candidate *cand = &candidates[c];
+    if (cand->first_mismatch == 1u << 24) {
+      printf("%-16s equivalent on all 2^24 inputs\n", cand->name);
+      continue;
+    }
+    unsigned data = cand->first_mismatch >> 16, crc = cand->first_mismatch & 0xffff;
+    printf("%-16s NOT EQUIVALENT: crcu8(%u, %u) = %u, expected %u\n", cand->name,
+           data, crc, cand->fn(data, crc), expected[crc][data]);
+    failed = 1;
+  }
+
+  // The wider steps of the linked variants, and crcu8 for reference.
+  const struct {
+    const char *name;
+    int linked;
+    const struct crc_step_descriptor *desc;
+    uint64_t (*step)(uint64_t data, uint64_t crc);
+  } steps[] = {
+      {"crcu8_original", crcu8_original != NULL, &crc16_arc, crcu8_original_step},
+      {"crcu16_original", crcu16_original != NULL, &crc16_arc_u16, crcu16_original_step},
+      {"crcu16_pass_ir", crcu16_pass_ir != NULL, &crc16_arc_u16, crcu16_pass_ir_step},
+      {"crcu16_pass_intr", crcu16_pass_intr != NULL, &crc16_arc_u16, crcu16_pass_intr_step},
+      {"crcu32_original", crcu32_original != NULL, &crc16_arc_u32, crcu32_original_step},
+      {"crcu32_pass_ir", crcu32_pass_ir != NULL, &crc16_arc_u32, crcu32_pass_ir_step},
+      {"crcu32_pass_intr", crcu32_pass_intr != NULL, &crc16_arc_u32, crcu32_pass_intr_step},
+  };
+  for (unsigned i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+    if (steps[i].linked)
+      failed |= check_linear_step(steps[i].name, steps[i].desc, steps[i].step,
+                                  1 << 16) != 0;
+
+  printf("%u implementations x 2^24 inputs on %ld threads in %.3f s\n",
+         num_candidates, threads,
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+  return failed;
+}
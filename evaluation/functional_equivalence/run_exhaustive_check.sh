@@ -0,0 +1,67 @@
+#!/bin/bash
+
+# Build every crcu8 variant next to exhaustive_check.c and check all 2^24
+# inputs of each of them:
+#   crcu8_original   unoptimized_crc.c
+#   crcu8_optimized  optimized_crc.c
+#   crcu8_pass_ir    unoptimized_crc.c + opt -crc-opt -passes=crc-recognition
+#   crcu8_pass_intr  unoptimized_crc.c + opt -crc-opt-intrinsic -passes=crc-recognition
+#                    (riscv64 only)
+# The crcu16 and crcu32 steps of unoptimized_crc.c are checked as well, as
+# crcu16_original, crcu16_pass_ir and so on. The sources are used as they are:
+# their main is renamed away and crcu8, crcu16 and crcu32 are renamed to the
+# variant with the preprocessor.
+#
+# Usage: ./run_exhaustive_check.sh [threads]
+#
+# Environment:
+#   LLVM_BIN       directory with clang and opt built with the CRC passes
+#                  (default: ../../../build/bin)
+#   TARGET         x86-64 (default) or riscv64, which runs under qemu
+#   RISCV_SYSROOT  sysroot of the riscv64 toolchain (default: /usr/riscv64-linux-gnu)
+#   QEMU_RISCV     qemu user mode emulator (default: qemu-riscv64)
+#   RISCV_CPU      qemu CPU model with the Zbc extension (default: rv64,zbc=true)
+#   OPT_LEVEL      optimization level of the variants (default: -O2)
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+LLVM_BIN=${LLVM_BIN:-$DIR/../../../build/bin}
+TARGET=${TARGET:-x86-64}
+OPT_LEVEL=${OPT_LEVEL:--O2}
+. "$DIR/../../scripts/crc_build_common.sh"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+FLAGS="$(target_flags "$TARGET")"
+
+objects=()
+
+# Preprocessor flags that rename crcu8, crcu16 and crcu32 to variant <name of crcu8>
+rename() {
+    echo "-Dcrcu8=$1 -Dcrcu16=${1/crcu8/crcu16} -Dcrcu32=${1/crcu8/crcu32} -Dmain=unused_main_$1"
+}
+
+# compile <source> <name of crcu8>
+compile() {
+    "$LLVM_BIN/clang" $FLAGS $OPT_LEVEL -c "$DIR/$1" $(rename $2) -Dcrcu8_optimized=$2 \
+        -o "$WORK/$2.o" && objects+=("$WORK/$2.o")
+}
+
+# compile_with_pass <pass flag> <name of crcu8>
+compile_with_pass() {
+    "$LLVM_BIN/clang" $FLAGS -O0 -Xclang -disable-O0-optnone -S -emit-llvm \
+        "$DIR/unoptimized_crc.c" $(rename $2) -o "$WORK/$2.ll" &&
+    "$LLVM_BIN/opt" -S $1 -passes=crc-recognition "$WORK/$2.ll" -o "$WORK/$2.crc.ll" 2>/dev/null &&
+    "$LLVM_BIN/clang" $FLAGS $OPT_LEVEL -c "$WORK/$2.crc.ll" -o "$WORK/$2.o" &&
+    objects+=("$WORK/$2.o")
+}
+
+compile unoptimized_crc.c crcu8_original || exit 1
+compile optimized_crc.c crcu8_optimized || exit 1
+compile_with_pass -crc-opt crcu8_pass_ir || echo "Skipping crcu8_pass_ir, opt could not build it"
+if [ "$TARGET" = riscv64 ]; then
+    compile_with_pass -crc-opt-intrinsic crcu8_pass_intr || echo "Skipping crcu8_pass_intr, opt could not build it"
+fi
+
+"$LLVM_BIN/clang" $FLAGS -O2 "$DIR/exhaustive_check.c" "${objects[@]}" -o "$WORK/exhaustive_check" -lpthread || exit 1
+$(target_runner "$TARGET") "$WORK/exhaustive_check" "$@"
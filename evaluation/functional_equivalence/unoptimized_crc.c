@@ -22,6 +22,22 @@ unsigned short crcu8(unsigned char data, unsigned short crc) {
     return crc;
 }
 
+// crcu16 and crcu32 of CoreMark (crcu32 with crcu16 inlined), whose steps the
+// intrinsic based optimization fuses into one wide step
+unsigned short crcu16(unsigned short newval, unsigned short crc) {
+    crc = crcu8((unsigned char)newval, crc);
+    crc = crcu8((unsigned char)(newval >> 8), crc);
+    return crc;
+}
+
+unsigned short crcu32(unsigned int newval, unsigned short crc) {
+    crc = crcu8((unsigned char)newval, crc);
+    crc = crcu8((unsigned char)(newval >> 8), crc);
+    crc = crcu8((unsigned char)(newval >> 16), crc);
+    crc = crcu8((unsigned char)(newval >> 24), crc);
+    return crc;
+}
+
 int main(){
 
   int data;
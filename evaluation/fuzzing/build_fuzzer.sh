@@ -0,0 +1,65 @@
+#!/bin/bash
+
+# Build the differential CRC fuzzer: crc_buffer.c as written, and the same
+# source through each lowering of the CRC passes,
+#   pass_ir    -crc-opt                               (IR level optimization)
+#   table      -crc-opt-intrinsic -crc-lowering=table (steps become table lookups)
+#   libcall    -crc-opt-intrinsic -crc-lowering=libcall, linked with the CRC
+#              runtime, which is also compared on its own
+#   pass_intr  -crc-opt-intrinsic                     (riscv64 only)
+# all linked into one libFuzzer binary.
+#
+# Usage: ./build_fuzzer.sh [output]
+#        ./crc_fuzz -max_len=4096 corpus/
+#
+# Environment:
+#   LLVM_BIN       directory with clang and opt built with the CRC passes
+#                  (default: ../../../build/bin)
+#   TARGET         x86-64 (default) or riscv64
+#   RISCV_SYSROOT  sysroot of the riscv64 toolchain (default: /usr/riscv64-linux-gnu)
+#   OPT_LEVEL      optimization level of the variants (default: -O2)
+#   STANDALONE     set to build with the random input driver of crc_fuzz.c
+#                  instead of libFuzzer
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+OUT=${1:-crc_fuzz}
+LLVM_BIN=${LLVM_BIN:-$DIR/../../../build/bin}
+TARGET=${TARGET:-x86-64}
+OPT_LEVEL=${OPT_LEVEL:--O2}
+. "$DIR/../../scripts/crc_build_common.sh"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+FLAGS="$(target_flags "$TARGET")"
+
+if [ -n "$STANDALONE" ]; then
+    FUZZ_FLAGS="-DCRC_FUZZ_STANDALONE"
+else
+    FUZZ_FLAGS="-fsanitize=fuzzer"
+fi
+
+objects=()
+
+# variant <name> <opt flags> <opt pipeline>
+variant() {
+    crc_variant "$TARGET" "$WORK" "$DIR/crc_buffer.c" crc_buffer "$@"
+}
+
+"$LLVM_BIN/clang" $FLAGS $OPT_LEVEL -c "$DIR/crc_buffer.c" \
+    -Dcrc_buffer=crc_buffer_original -o "$WORK/original.o" || exit 1
+objects+=("$WORK/original.o")
+
+variant pass_ir "-crc-opt" "crc-recognition"
+variant table "-crc-opt-intrinsic -crc-lowering=table" "$CRC_LOOP_PIPELINE"
+variant libcall "-crc-opt-intrinsic -crc-lowering=libcall" "$CRC_LOOP_PIPELINE"
+if [ "$TARGET" = riscv64 ]; then
+    variant pass_intr "-crc-opt-intrinsic" "crc-recognition"
+fi
+
+# The CRC runtime, for the libcall variant and to be compared on its own
+build_crc_runtime_objects "$TARGET" "$WORK/runtime" || exit 1
+
+"$LLVM_BIN/clang" $FLAGS -O1 -g $FUZZ_FLAGS "$DIR/crc_fuzz.c" "${objects[@]}" \
+    "$WORK"/runtime/*.o -o "$OUT" || exit 1
+echo "Built $OUT"
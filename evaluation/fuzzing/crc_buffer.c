@@ -0,0 +1,33 @@
+#include <stddef.h>
+
+// crcu8 exactly as in evaluation/time_measurement/unoptimized_crc.c, so that
+// the recognizer finds it. It is static, so that nothing is left of it once
+// the loop below has been lowered to a call of the CRC runtime.
+static unsigned short crcu8(unsigned char data, unsigned short crc) {
+    unsigned char i = 0, x16 = 0, carry = 0;
+    for (i = 0; i < 8; i++) {
+      x16 = (unsigned char)((data & 1) ^ ((unsigned char)crc & 1));
+      data >>= 1;
+      if (x16 == 1) {
+        carry = 1;
+        crc ^= 0x4002;
+      } else {
+       carry = 0;
+      } 
+      crc >>= 1;
+     if (carry)
+      crc |= 0x8000;
+     else
+      crc &= 0x7fff;
+     }
+    return crc;
+}
+
+// Buffer level CRC, compiled once per variant under a different name
+// (-Dcrc_buffer=crc_buffer_<variant>, see build_fuzzer.sh).
+unsigned short crc_buffer(const unsigned char *buf, size_t len,
+                          unsigned short crc) {
+  for (size_t i = 0; i < len; i++)
+    crc = crcu8(buf[i], crc);
+  return crc;
+}
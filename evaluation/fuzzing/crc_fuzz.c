@@ -0,0 +1,117 @@
+// Differential fuzzer for the buffer level CRC lowerings.
+//
+// crc_buffer.c is compiled once as written and once per lowering of the CRC
+// passes (see build_fuzzer.sh). The fuzzer picks the initial CRC, the
+// alignment of the buffer and its contents and length; every variant that is
+// linked in has to compute the same CRC as the original, otherwise the
+// inputs are printed and the fuzzer stops. Variants that are not linked in
+// (they are weak) are skipped, and so is the CRC runtime itself, which is
+// compared directly when it is linked in.
+//
+// Input layout: crc (2 bytes, little endian), offset (1 byte), data.
+//
+// Built with -fsanitize=fuzzer this is a libFuzzer target. Built with
+// -DCRC_FUZZ_STANDALONE it runs on random inputs instead, for toolchains
+// without libFuzzer:  ./crc_fuzz [iterations] [seed]
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../implementations/crc-runtime/crc_runtime.h"
+
+unsigned short crc_buffer_original(const unsigned char *buf, size_t len, unsigned short crc);
+unsigned short crc_buffer_pass_ir(const unsigned char *buf, size_t len, unsigned short crc) __attribute__((weak));
+unsigned short crc_buffer_pass_intr(const unsigned char *buf, size_t len, unsigned short crc) __attribute__((weak));
+unsigned short crc_buffer_table(const unsigned char *buf, size_t len, unsigned short crc) __attribute__((weak));
+unsigned short crc_buffer_libcall(const unsigned char *buf, size_t len, unsigned short crc) __attribute__((weak));
+
+// The runtime is optional as well
+uint64_t __crc_update(const struct crc_descriptor *desc, uint64_t crc,
+                      const unsigned char *buf, size_t len) __attribute__((weak));
+
+typedef unsigned short (*crc_buffer_fn)(const unsigned char *, size_t, unsigned short);
+
+static const struct {
+  const char *name;
+  crc_buffer_fn fn;
+} variants[] = {
+    {"pass_ir", crc_buffer_pass_ir},
+    {"pass_intr", crc_buffer_pass_intr},
+    {"table", crc_buffer_table},
+    {"libcall", crc_buffer_libcall},
+};
+
+// CRC-16/ARC, the CRC crcu8 computes
+static const struct crc_descriptor crc16_arc = {16, 1, 1, 0x8005, 0, 0};
+
+#define MAX_OFFSET 64
+#define MAX_LENGTH (1 << 16)
+
+static void report_mismatch(const char *name, unsigned short got,
+                            unsigned short expected, unsigned short crc,
+                            unsigned offset, size_t len) {
+  fprintf(stderr,
+          "%s: crc_buffer(len %zu, offset %u, crc %u) = %u, original gives %u\n",
+          name, len, offset, crc, got, expected);
+  abort();
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static unsigned char storage[MAX_OFFSET + MAX_LENGTH] __attribute__((aligned(64)));
+  if (size < 3)
+    return 0;
+
+  unsigned short crc = data[0] | data[1] << 8;
+  unsigned offset = data[2] % MAX_OFFSET;
+  size_t len = size - 3 < MAX_LENGTH ? size - 3 : MAX_LENGTH;
+  unsigned char *buf = storage + offset;
+  memcpy(buf, data + 3, len);
+
+  unsigned short expected = crc_buffer_original(buf, len, crc);
+  for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+    if (!variants[i].fn)
+      continue;
+    unsigned short got = variants[i].fn(buf, len, crc);
+    if (got != expected)
+      report_mismatch(variants[i].name, got, expected, crc, offset, len);
+  }
+
+  if (__crc_update) {
+    unsigned short got = (unsigned short)__crc_update(&crc16_arc, crc, buf, len);
+    if (got != expected)
+      report_mismatch("runtime", got, expected, crc, offset, len);
+  }
+
+  return 0;
+}
+
+#ifdef CRC_FUZZ_STANDALONE
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 100000;
+  uint64_t state = argc > 2 ? strtoull(argv[2], NULL, 0) : 1;
+  static uint8_t input[3 + MAX_LENGTH];
+
+  for (long i = 0; i < iterations; i++) {
+    // xorshift64*, mostly short inputs with an occasional long one
+    size_t size = 0;
+    for (size_t j = 0; j < sizeof(input); j++) {
+      state ^= state >> 12;
+      state ^= state << 25;
+      state ^= state >> 27;
+      uint64_t r = state * 0x2545f4914f6cdd1du;
+      if (j == 0)
+        size = 3 + (r >> 32) % (r & 15 ? 300 : MAX_LENGTH);
+      if (j == size)
+        break;
+      input[j] = (uint8_t)(r >> 56);
+    }
+    LLVMFuzzerTestOneInput(input, size);
+  }
+
+  printf("%ld inputs, no mismatches\n", iterations);
+  return 0;
+}
+#endif
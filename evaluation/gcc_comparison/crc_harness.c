@@ -0,0 +1,126 @@
+// Timing harness for one CRC function of corpus.txt.
+//
+// The source of the function is compiled on its own (its main renamed away)
+// by the compiler under comparison, and linked with this harness, so every
+// compiler gets the CRC code in the same form and the calls are not inlined
+// into the timing loop by some and not by others. CRC_FUNCTION names the
+// function and CRC_KIND_<kind> selects its signature, see corpus.txt. The
+// harness of evaluation/time_measurement does the timing and prints
+// cycles/byte and the checksum of all results.
+//
+// Byte step functions are called once per input pair. Buffer functions are
+// called on the data bytes of the inputs, CRC_BUFFER_SIZE bytes per call and
+// each call starting from CRC_INIT. With CRC_CHECK set the function has to
+// give that value for "123456789" from CRC_INIT first (the check value of the
+// CRC catalogue for the CRCs that start from CRC_INIT), otherwise the harness
+// fails before timing anything.
+
+#include "../time_measurement/benchmark.h"
+
+#ifndef CRC_FUNCTION
+#error "CRC_FUNCTION has to name the CRC function under test"
+#endif
+
+#define CRC_STRING_(x) #x
+#define CRC_STRING(x) CRC_STRING_(x)
+
+#if defined(CRC_KIND_STEP8)
+unsigned short CRC_FUNCTION(unsigned char data, unsigned short crc);
+#elif defined(CRC_KIND_BUF8)
+typedef uint8_t crc_register;
+#elif defined(CRC_KIND_BUF16)
+typedef uint16_t crc_register;
+#elif defined(CRC_KIND_BUF32)
+typedef uint32_t crc_register;
+#else
+#error "Unknown CRC_KIND"
+#endif
+
+#ifndef CRC_KIND_STEP8
+#define CRC_BUFFER_KIND 1
+crc_register CRC_FUNCTION(crc_register crc, const unsigned char *buf, size_t len);
+
+#ifndef CRC_INIT
+#define CRC_INIT 0
+#endif
+#ifndef CRC_BUFFER_SIZE
+#define CRC_BUFFER_SIZE 4096
+#endif
+
+// Time repetitions passes of CRC_FUNCTION over the data bytes of the inputs
+// and print the results in the format of RUN_CRC_THROUGHPUT.
+static int run_buffer_throughput(const char *name, const struct crc_inputs *in,
+                                 int repetitions) {
+  size_t calls = in->count / CRC_BUFFER_SIZE;
+  if (!calls) {
+    fprintf(stderr, "%s: need at least %d inputs for one buffer\n", name,
+            CRC_BUFFER_SIZE);
+    return 1;
+  }
+
+  double *ns = malloc(repetitions * sizeof(double));
+  double *cycles = malloc(repetitions * sizeof(double));
+  unsigned checksum = 0;
+  printf("%s: %zu calls of %d bytes x %d repetitions\n", name, calls,
+         CRC_BUFFER_SIZE, repetitions);
+  for (int r = 0; r < repetitions; r++) {
+    double start_ns = now_ns();
+    uint64_t start_cycles = read_cycles();
+    for (size_t i = 0; i < calls; i++)
+      checksum += CRC_FUNCTION(CRC_INIT, in->data + i * CRC_BUFFER_SIZE,
+                               CRC_BUFFER_SIZE);
+    cycles[r] = (double)(read_cycles() - start_cycles);
+    ns[r] = now_ns() - start_ns;
+  }
+  print_statistics("ns/call", ns, repetitions, (double)calls);
+  if (cycles[0] != 0)
+    print_statistics("cycles/byte", cycles, repetitions,
+                     (double)calls * CRC_BUFFER_SIZE);
+  printf("  checksum       %u\n", checksum);
+  free(ns);
+  free(cycles);
+  return 0;
+}
+#endif
+
+#ifdef CRC_CHECK
+// The CRC of "123456789", as listed in the CRC catalogue.
+static int check_catalogue_value(const char *name) {
+  static const unsigned char message[] = "123456789";
+#ifdef CRC_BUFFER_KIND
+  uint64_t crc = CRC_FUNCTION(CRC_INIT, message, 9);
+#else
+  uint64_t crc = CRC_INIT;
+  for (int i = 0; i < 9; i++)
+    crc = CRC_FUNCTION(message[i], crc);
+#endif
+  if (crc == (uint64_t)(CRC_CHECK))
+    return 0;
+  fprintf(stderr, "%s: CRC of \"123456789\" is 0x%llx, expected 0x%llx\n", name,
+          (unsigned long long)crc, (unsigned long long)(CRC_CHECK));
+  return 1;
+}
+#endif
+
+int main(int argc, char **argv) {
+  struct crc_inputs inputs;
+  int repetitions;
+
+  if (parse_arguments(argc, argv, &inputs, &repetitions))
+    return -1;
+
+#ifdef CRC_CHECK
+  if (check_catalogue_value(CRC_STRING(CRC_FUNCTION)))
+    return 1;
+#endif
+
+#ifdef CRC_BUFFER_KIND
+  int failed = run_buffer_throughput(CRC_STRING(CRC_FUNCTION), &inputs, repetitions);
+#else
+  RUN_CRC_THROUGHPUT(CRC_STRING(CRC_FUNCTION), CRC_FUNCTION, inputs, repetitions);
+  int failed = 0;
+#endif
+
+  free_inputs(&inputs);
+  return failed;
+}
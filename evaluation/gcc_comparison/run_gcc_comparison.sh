@@ -0,0 +1,155 @@
+#!/bin/bash
+
+# Compare the CRC recognition of GCC (-foptimize-crc, GCC 15 and later) with
+# clang + the CRC passes of this repository on the implementations listed in
+# corpus.txt. Every implementation is built for every target with
+#   gcc         gcc -foptimize-crc
+#   gcc-nocrc   gcc -fno-optimize-crc, the same compiler without the pass
+#   clang       clang without the CRC passes
+#   clang-crc   clang, with the CRC passes run on the unoptimized IR
+# and linked with crc_harness.c, which reports cycles/byte and a checksum.
+# An implementation counts as recognized by GCC when its function calls the
+# .CRC/.CRC_REV internal functions in the optimized GIMPLE dump, and by the
+# CRC passes when they report the CRCCost remark for it. Variants whose
+# checksum differs from gcc-nocrc are reported as checksum mismatches.
+#
+# Usage: ./run_gcc_comparison.sh [output.csv] [repetitions]
+#
+# Environment:
+#   LLVM_BIN       directory with clang and opt built with the CRC passes
+#                  (default: ../../../build/bin)
+#   GCC            host gcc (default: gcc)
+#   RISCV_GCC      riscv64 cross gcc (default: riscv64-linux-gnu-gcc)
+#   TARGETS        targets to run (default: "x86-64 riscv64")
+#   CORPUS         list of implementations (default: corpus.txt next to this script,
+#                  ../crc_corpus/corpus.txt is the larger one of real-world CRCs)
+#   OPT_LEVEL      optimization level of all variants (default: -O2)
+#   PASS_FLAGS_X86   CRC pass options on x86-64 (default: -crc-opt)
+#   PASS_FLAGS_RISCV CRC pass options on riscv64 (default: -crc-opt-intrinsic)
+#   RISCV_SYSROOT  sysroot of the riscv64 toolchain (default: /usr/riscv64-linux-gnu)
+#   QEMU_RISCV     qemu user mode emulator (default: qemu-riscv64)
+#   RISCV_CPU      qemu CPU model with the Zbc extension (default: rv64,zbc=true)
+#   INPUTS         inputs file (default: evaluation/time_measurement/inputs.txt)
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+ROOT="$(cd "$DIR/../.." && pwd)"
+OUTPUT=${1:-gcc_comparison_results.csv}
+REPETITIONS=${2:-15}
+LLVM_BIN=${LLVM_BIN:-$DIR/../../../build/bin}
+GCC=${GCC:-gcc}
+RISCV_GCC=${RISCV_GCC:-riscv64-linux-gnu-gcc}
+TARGETS=${TARGETS:-"x86-64 riscv64"}
+CORPUS=${CORPUS:-$DIR/corpus.txt}
+OPT_LEVEL=${OPT_LEVEL:--O2}
+PASS_FLAGS_X86=${PASS_FLAGS_X86:--crc-opt}
+PASS_FLAGS_RISCV=${PASS_FLAGS_RISCV:--crc-opt-intrinsic}
+INPUTS=${INPUTS:-$DIR/../time_measurement/inputs.txt}
+. "$ROOT/scripts/crc_build_common.sh"
+
+WORK="$OUTPUT.build"
+mkdir -p "$WORK" || exit 1
+
+# gcc of a target and its flags
+target_gcc() {
+    case $1 in
+        x86-64) echo "$GCC -march=x86-64" ;;
+        riscv64) echo "$RISCV_GCC -march=rv64gc_zbc -static" ;;
+    esac
+}
+
+# Compile the corpus source of an implementation to an object. Prints
+# "yes"/"no" for whether the CRC was recognized, nothing when the compiler
+# does not try.
+# compile <compiler> <target> <source> <function> <output object>
+compile() {
+    local compiler=$1 target=$2 src=$3 fn=$4 out=$5
+    local rename="-Dmain=corpus_main"
+    case $compiler in
+        gcc)
+            $(target_gcc "$target") $OPT_LEVEL -foptimize-crc $rename \
+                -fdump-tree-optimized="$out.optimized" -c "$src" -o "$out" || return 1
+            # .CRC (...) / .CRC_REV (...) calls in the body of fn
+            awk -v fn="$fn" '/^;; Function / { in_fn = ($3 == fn) }
+                in_fn && /\.CRC(_REV)? \(/ { found = 1 }
+                END { print found ? "yes" : "no" }' "$out.optimized" ;;
+        gcc-nocrc)
+            $(target_gcc "$target") $OPT_LEVEL -fno-optimize-crc $rename -c "$src" -o "$out" ;;
+        clang)
+            "$LLVM_BIN/clang" $(target_flags "$target") $OPT_LEVEL $rename -c "$src" -o "$out" ;;
+        clang-crc)
+            local flags pass_flags=$PASS_FLAGS_X86
+            flags="$(target_flags "$target")"
+            [ "$target" = riscv64 ] && pass_flags=$PASS_FLAGS_RISCV
+            "$LLVM_BIN/clang" $flags -O0 -Xclang -disable-O0-optnone -S -emit-llvm \
+                $rename "$src" -o "$out.ll" &&
+            "$LLVM_BIN/opt" -S $pass_flags -passes=crc-recognition \
+                -pass-remarks=crc-recognition "$out.ll" -o "$out.crc.ll" 2>"$out.remarks" &&
+            "$LLVM_BIN/clang" $flags $OPT_LEVEL -c "$out.crc.ll" -o "$out" || return 1
+            if grep -q "CRC in $fn lowered" "$out.remarks"; then echo yes; else echo no; fi ;;
+    esac
+}
+
+# Does the gcc of a target know -foptimize-crc?
+gcc_has_crc_pass() {
+    echo "int x;" | $(target_gcc "$1") -foptimize-crc -x c -c - -o /dev/null 2>/dev/null
+}
+
+echo "implementation,function,target,compiler,status,recognized,cycles_byte_median,ns_call_median,checksum" > "$OUTPUT"
+
+for target in $TARGETS; do
+    if ! gcc_has_crc_pass "$target"; then
+        echo "$target: $(target_gcc "$target" | cut -d' ' -f1) does not support -foptimize-crc (GCC 15 or later), skipped"
+        continue
+    fi
+    declare -A recognized_count=() total_count=()
+
+    while read -r name src fn kind init check _; do
+        [ -z "$name" ] || [[ $name == \#* ]] && continue
+        kind_flag="-DCRC_KIND_$(echo "$kind" | tr a-z A-Z)"
+        check_flags=""
+        [ -n "$check" ] && check_flags="-DCRC_INIT=$init -DCRC_CHECK=$check"
+        # The harness is the same object for every compiler
+        harness="$WORK/harness-$name-$target.o"
+        $(target_gcc "$target") $OPT_LEVEL -DCRC_FUNCTION="$fn" $kind_flag $check_flags \
+            -c "$DIR/crc_harness.c" -o "$harness" 2>"$harness.log"
+
+        reference=""
+        for compiler in gcc-nocrc gcc clang clang-crc; do
+            obj="$WORK/$name-$compiler-$target.o"
+            bin="$WORK/$name-$compiler-$target"
+            status=ok; recognized=""; cycles=""; ns=""; checksum=""
+            if ! recognized=$(compile "$compiler" "$target" "$ROOT/$src" "$fn" "$obj" 2>"$obj.log") ||
+               ! $(target_gcc "$target") "$harness" "$obj" -o "$bin" -lm 2>>"$obj.log"; then
+                status="build failed, see $obj.log"
+            else
+                result=$($(target_runner "$target") "$bin" "$INPUTS" "$REPETITIONS" 2>&1)
+                if [ $? -ne 0 ]; then
+                    status="run failed"
+                else
+                    ns=$(echo "$result" | awk '/ns\/call/ { print $5 }')
+                    cycles=$(echo "$result" | awk '/cycles\/byte/ { print $5 }')
+                    checksum=$(echo "$result" | awk '/checksum/ { print $2 }')
+                    [ -z "$reference" ] && reference=$checksum
+                    [ "$checksum" != "$reference" ] && status="checksum mismatch"
+                fi
+            fi
+
+            total_count[$compiler]=$((${total_count[$compiler]:-0} + 1))
+            [ "$recognized" = yes ] &&
+                recognized_count[$compiler]=$((${recognized_count[$compiler]:-0} + 1))
+            if [ "$status" = ok ]; then
+                echo "$name $target $compiler: ${cycles:-?} cycles/byte, recognized ${recognized:--}"
+            else
+                echo "$name $target $compiler: $status"
+            fi
+            echo "$name,$fn,$target,$compiler,\"$status\",$recognized,$cycles,$ns,$checksum" >> "$OUTPUT"
+        done
+    done < "$CORPUS"
+
+    for compiler in gcc clang-crc; do
+        echo "$target $compiler: ${recognized_count[$compiler]:-0} of ${total_count[$compiler]:-0} implementations recognized"
+    done
+    unset recognized_count total_count
+done
+
+echo "Results written to $OUTPUT"
@@ -0,0 +1,58 @@
+// QEMU TCG plugin that counts the guest instructions a program executes.
+//
+// Every translated block gets a callback that adds its number of
+// instructions to a counter, so the count is exact and does not depend on
+// the host, unlike the time of a run under emulation. The count is written
+// when the program exits, as "instructions N", to the file given with
+// out=<path> or to stderr:
+//
+//   qemu-riscv64 -plugin ./libinsn_count.so,out=count.txt ./program
+//
+// Only the plugin API that has been stable since QEMU 4.2 is used.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <qemu-plugin.h>
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+static uint64_t instructions;
+static const char *out_path;
+
+static void tb_exec(unsigned int vcpu_index, void *udata) {
+  __atomic_fetch_add(&instructions, (uint64_t)(uintptr_t)udata,
+                     __ATOMIC_RELAXED);
+}
+
+static void tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb) {
+  qemu_plugin_register_vcpu_tb_exec_cb(
+      tb, tb_exec, QEMU_PLUGIN_CB_NO_REGS,
+      (void *)(uintptr_t)qemu_plugin_tb_n_insns(tb));
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *udata) {
+  FILE *out = out_path ? fopen(out_path, "w") : NULL;
+  fprintf(out ? out : stderr, "instructions %llu\n",
+          (unsigned long long)instructions);
+  if (out)
+    fclose(out);
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info, int argc,
+                                           char **argv) {
+  for (int i = 0; i < argc; i++) {
+    if (strncmp(argv[i], "out=", 4) == 0) {
+      out_path = strdup(argv[i] + 4);
+    } else {
+      fprintf(stderr, "insn_count: unknown argument %s\n", argv[i]);
+      return -1;
+    }
+  }
+
+  qemu_plugin_register_vcpu_tb_trans_cb(id, tb_trans);
+  qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+  return 0;
+}
@@ -0,0 +1,129 @@
+#!/bin/bash
+
+# Dynamic instruction count of every crcu8 lowering on RISC-V. The benchmark
+# of evaluation/time_measurement is built for riscv64 with
+#   bitwise  unoptimized_crc.c as written
+#   ir       unoptimized_crc.c + the IR level CRC optimization
+#   table    unoptimized_crc.c + the intrinsic, lowered to table lookups
+#   zbc      unoptimized_crc.c + the intrinsic, lowered to Zbc instructions
+# and run under qemu user mode with the insn_count plugin, once with one
+# repetition and once with two. The difference is the number of instructions
+# of one pass over the inputs, without the start up and input parsing, and
+# divided by the number of inputs it gives instructions per CRC byte, which
+# does not depend on the host the way the time under emulation does.
+#
+# The results are compared with the baselines in baselines.csv; a lowering
+# that needs more instructions than its baseline (plus TOLERANCE percent) is
+# reported as a regression and the script fails. So does a lowering that has
+# no baseline for OPT_LEVEL, or that could not be built or run: baselines.csv
+# is not part of the repository, because the counts depend on the versions of
+# qemu and LLVM, and it has to be written first with UPDATE_BASELINES=1, which
+# replaces the baselines by the results of this run instead of checking them.
+#
+# Usage: ./run_instruction_count.sh [output.csv]
+#
+# Environment:
+#   LLVM_BIN           directory with clang and opt built with the CRC passes
+#                      (default: ../../../build/bin)
+#   RISCV_SYSROOT      sysroot of the riscv64 toolchain (default: /usr/riscv64-linux-gnu)
+#   QEMU_RISCV         qemu user mode emulator (default: qemu-riscv64)
+#   RISCV_CPU          qemu CPU model with the Zbc extension (default: rv64,zbc=true)
+#   QEMU_PLUGIN_INCLUDE directory with qemu-plugin.h (default: /usr/include/qemu)
+#   HOST_CC            compiler for the plugin (default: cc)
+#   OPT_LEVEL          optimization level of the variants (default: -O2)
+#   INPUTS             inputs file (default: evaluation/time_measurement/inputs.txt)
+#   BASELINES          baselines file (default: baselines.csv next to this script)
+#   TOLERANCE          allowed increase over the baseline in percent (default: 0.5)
+#   UPDATE_BASELINES   set to 1 to write the baselines instead of checking them
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+OUTPUT=${1:-instruction_count_results.csv}
+SRC="$DIR/../time_measurement"
+LLVM_BIN=${LLVM_BIN:-$DIR/../../../build/bin}
+QEMU_PLUGIN_INCLUDE=${QEMU_PLUGIN_INCLUDE:-/usr/include/qemu}
+HOST_CC=${HOST_CC:-cc}
+OPT_LEVEL=${OPT_LEVEL:--O2}
+INPUTS=${INPUTS:-$SRC/inputs.txt}
+BASELINES=${BASELINES:-$DIR/baselines.csv}
+TOLERANCE=${TOLERANCE:-0.5}
+. "$DIR/../../scripts/crc_build_common.sh"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Neither the cycle CSR nor perf counters are of any use under emulation
+FLAGS="$(target_flags riscv64) -DBENCH_NO_CYCLES -DBENCH_NO_PERF"
+
+"$HOST_CC" -shared -fPIC -O2 -I"$QEMU_PLUGIN_INCLUDE" \
+    $(pkg-config --cflags glib-2.0 2>/dev/null) \
+    "$DIR/insn_count.c" -o "$WORK/libinsn_count.so" || exit 1
+
+# build <lowering> <output>
+build() {
+    local pass_flags pipeline=crc-recognition
+    case $1 in
+        bitwise)
+            "$LLVM_BIN/clang" $FLAGS $OPT_LEVEL "$SRC/unoptimized_crc.c" -o "$2" -lm
+            return ;;
+        ir) pass_flags="-crc-opt" ;;
+        table) pass_flags="-crc-opt-intrinsic -crc-lowering=table"; pipeline=$CRC_LOOP_PIPELINE ;;
+        zbc) pass_flags="-crc-opt-intrinsic" ;;
+    esac
+    "$LLVM_BIN/clang" $FLAGS -O0 -Xclang -disable-O0-optnone -S -emit-llvm \
+        "$SRC/unoptimized_crc.c" -o "$2.ll" &&
+    "$LLVM_BIN/opt" -S $pass_flags -passes="$pipeline" "$2.ll" -o "$2.crc.ll" 2>/dev/null &&
+    "$LLVM_BIN/clang" $FLAGS $OPT_LEVEL "$2.crc.ll" -o "$2" -lm
+}
+
+# count <binary> <repetitions>
+count() {
+    $(target_runner riscv64) -plugin "$WORK/libinsn_count.so,out=$WORK/count" \
+        "$1" "$INPUTS" "$2" >/dev/null &&
+    awk '/^instructions/ { print $2 }' "$WORK/count"
+}
+
+# Text inputs have a pair per line, binary ones their count in the header
+if [ "$(head -c 8 "$INPUTS")" = CRCINPUT ]; then
+    inputs=$(od -An -t u8 -j 8 -N 8 "$INPUTS" | tr -d ' ')
+else
+    inputs=$(awk 'NF == 2' "$INPUTS" | wc -l)
+fi
+failed=0
+echo "lowering,optimization,status,instructions_per_byte,baseline" > "$OUTPUT"
+[ "$UPDATE_BASELINES" = 1 ] && echo "lowering,optimization,instructions_per_byte" > "$WORK/baselines"
+
+for lowering in bitwise ir table zbc; do
+    bin="$WORK/$lowering"
+    status=ok; per_byte=""
+    if ! build "$lowering" "$bin" 2>"$WORK/log"; then
+        status="build failed"
+    elif ! one=$(count "$bin" 1) || ! two=$(count "$bin" 2) || [ -z "$one" ] || [ -z "$two" ]; then
+        status="run failed"
+    else
+        per_byte=$(awk -v a="$one" -v b="$two" -v n="$inputs" 'BEGIN { printf "%.3f", (b - a) / n }')
+    fi
+
+    baseline=$(awk -F, -v l="$lowering" -v o="$OPT_LEVEL" '$1 == l && $2 == o { print $3 }' "$BASELINES" 2>/dev/null)
+    if [ "$status" = ok ] && [ "$UPDATE_BASELINES" = 1 ]; then
+        echo "$lowering,$OPT_LEVEL,$per_byte" >> "$WORK/baselines"
+        baseline=$per_byte
+    elif [ "$status" = ok ] && [ -z "$baseline" ]; then
+        status="no baseline, run with UPDATE_BASELINES=1 first"
+    elif [ "$status" = ok ] &&
+         awk -v v="$per_byte" -v b="$baseline" -v t="$TOLERANCE" 'BEGIN { exit !(v > b * (1 + t / 100)) }'; then
+        status="regression"
+    fi
+    [ "$status" != ok ] && failed=1
+
+    echo "$lowering $OPT_LEVEL: $status, $per_byte instructions/byte (baseline ${baseline:-none})"
+    echo "$lowering,$OPT_LEVEL,\"$status\",$per_byte,$baseline" >> "$OUTPUT"
+done
+
+if [ "$UPDATE_BASELINES" = 1 ]; then
+    # Keep the baselines of the other optimization levels
+    awk -F, -v o="$OPT_LEVEL" 'NR > 1 && $2 != o' "$BASELINES" 2>/dev/null >> "$WORK/baselines"
+    cp "$WORK/baselines" "$BASELINES"
+    echo "Baselines written to $BASELINES"
+fi
+echo "Results written to $OUTPUT"
+exit $failed
@@ -0,0 +1,180 @@
+// Compares two commits of a results history written by record_results.sh.
+//
+//   compare_results <history.csv> <baseline commit> <new commit> [alpha]
+//
+// For every variant, flags, target and metric both commits have samples of,
+// the samples are compared with a one-sided Mann-Whitney U test (is the new
+// commit slower, resp. faster?), which does not assume the times are normally
+// distributed, and a bootstrap confidence interval of the ratio of the
+// medians (new / baseline). A change is reported as significant when the
+// test rejects at alpha (default 0.01) and the 1 - alpha confidence interval
+// does not contain 1. The exit status is 1 when any variant got slower.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+// variant, flags, target, metric
+typedef tuple<string, string, string, string> SeriesKey;
+
+struct Series {
+    vector<double> baseline;
+    vector<double> current;
+};
+
+// Split a line of the history at commas outside of double quotes
+static vector<string> splitCSV(const string &line){
+    vector<string> fields(1);
+    bool quoted = false;
+    for(char c : line){
+        if(c == '"')
+            quoted = !quoted;
+        else if(c == ',' && !quoted)
+            fields.emplace_back();
+        else
+            fields.back() += c;
+    }
+    return fields;
+}
+
+static double median(vector<double> values){
+    sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// One-sided p-value of the Mann-Whitney U test for the samples of b being
+// larger than those of a, with average ranks for ties and the normal
+// approximation with tie and continuity corrections.
+static double mannWhitneyGreater(const vector<double> &a, const vector<double> &b){
+    vector<pair<double, int>> all;
+    for(double v : a)
+        all.push_back({v, 0});
+    for(double v : b)
+        all.push_back({v, 1});
+    sort(all.begin(), all.end());
+
+    double n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    double rankSumB = 0, tieTerm = 0;
+    for(size_t i = 0; i < all.size();){
+        size_t j = i;
+        while(j < all.size() && all[j].first == all[i].first)
+            j++;
+        double rank = (i + 1 + j) / 2.0, ties = j - i;
+        for(size_t k = i; k < j; k++)
+            if(all[k].second)
+                rankSumB += rank;
+        tieTerm += ties * ties * ties - ties;
+        i = j;
+    }
+
+    double u = rankSumB - n2 * (n2 + 1) / 2;
+    double mean = n1 * n2 / 2;
+    double variance = n1 * n2 / 12 * ((n + 1) - tieTerm / (n * (n - 1)));
+    if(variance <= 0)
+        return 1;
+    double z = (u - mean - 0.5) / sqrt(variance);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+static uint64_t nextRandom(uint64_t &state){
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1du;
+}
+
+static vector<double> resample(const vector<double> &values, uint64_t &state){
+    vector<double> result(values.size());
+    for(double &v : result)
+        v = values[nextRandom(state) % values.size()];
+    return result;
+}
+
+// Percentile bootstrap confidence interval of median(b) / median(a)
+static pair<double, double> bootstrapRatio(const vector<double> &a, const vector<double> &b,
+                                           double alpha, int rounds = 10000){
+    uint64_t state = 0x9e3779b97f4a7c15u;
+    vector<double> ratios;
+    ratios.reserve(rounds);
+    for(int i = 0; i < rounds; i++)
+        ratios.push_back(median(resample(b, state)) / median(resample(a, state)));
+    sort(ratios.begin(), ratios.end());
+    size_t low = (size_t)(alpha / 2 * rounds), high = (size_t)((1 - alpha / 2) * rounds);
+    return {ratios[low], ratios[min(high, ratios.size() - 1)]};
+}
+
+int main(int argc, char **argv){
+    if(argc < 4){
+        cerr << "Usage: " << argv[0] << " <history.csv> <baseline commit> <new commit> [alpha]\n";
+        exit(2);
+    }
+
+    string baseline = argv[2], current = argv[3];
+    double alpha = argc > 4 ? atof(argv[4]) : 0.01;
+    ifstream history(argv[1]);
+    if(!history){
+        cerr << "Could not read " << argv[1] << "\n";
+        exit(2);
+    }
+
+    map<SeriesKey, Series> series;
+    string line;
+    getline(history, line);
+    while(getline(history, line)){
+        vector<string> f = splitCSV(line);
+        if(f.size() != 8)
+            continue;
+        // date, commit, variant, flags, target, metric, repetition, value
+        SeriesKey key(f[2], f[3], f[4], f[5]);
+        if(f[1] == baseline)
+            series[key].baseline.push_back(atof(f[7].c_str()));
+        else if(f[1] == current)
+            series[key].current.push_back(atof(f[7].c_str()));
+    }
+
+    printf("%-18s %-20s %-8s %-12s %5s %5s %10s %10s %8s %17s  %s\n", "variant", "flags",
+           "target", "metric", "n old", "n new", "median old", "median new", "p", "ratio CI", "verdict");
+    int slower = 0, compared = 0;
+    for(const auto &entry : series){
+        const Series &s = entry.second;
+        if(s.baseline.size() < 3 || s.current.size() < 3)
+            continue;
+        compared++;
+
+        double pSlower = mannWhitneyGreater(s.baseline, s.current);
+        double pFaster = mannWhitneyGreater(s.current, s.baseline);
+        pair<double, double> ci = bootstrapRatio(s.baseline, s.current, alpha);
+        const char *verdict = "no significant change";
+        if(pSlower < alpha && ci.first > 1){
+            verdict = "SLOWER";
+            slower++;
+        } else if(pFaster < alpha && ci.second < 1){
+            verdict = "faster";
+        }
+
+        char interval[32];
+        snprintf(interval, sizeof(interval), "[%.3f, %.3f]", ci.first, ci.second);
+        printf("%-18s %-20s %-8s %-12s %5zu %5zu %10.3f %10.3f %8.2g %17s  %s\n",
+               get<0>(entry.first).c_str(), get<1>(entry.first).c_str(),
+               get<2>(entry.first).c_str(), get<3>(entry.first).c_str(),
+               s.baseline.size(), s.current.size(), median(s.baseline),
+               median(s.current), min(pSlower, pFaster), interval, verdict);
+    }
+
+    if(!compared){
+        cerr << "No series with at least three samples of both " << baseline << " and " << current << "\n";
+        exit(2);
+    }
+    return slower ? 1 : 0;
+}
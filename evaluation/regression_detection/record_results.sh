@@ -0,0 +1,56 @@
+#!/bin/bash
+
+# Run a benchmark of evaluation/time_measurement and append the value of every
+# repetition to a results history, together with the commit, the compiler
+# flags and the target it was built for. compare_results then compares two
+# commits of the history.
+#
+# Usage: ./record_results.sh <history.csv> <benchmark binary> [benchmark arguments]
+# e.g.   FLAGS="-O2 -crc-opt" ./record_results.sh history.csv ./unoptimized_crc inputs.bin 30
+#
+# Environment:
+#   COMMIT   commit the binary was built from (default: HEAD of this repository,
+#            with -dirty appended when the tree has changes)
+#   FLAGS    compiler and pass flags the binary was built with (default: unknown)
+#   TARGET   target the binary was built for (default: uname -m)
+#   VARIANT  name of the CRC variant (default: the name the benchmark prints)
+#   RUNNER   command prefix that runs the binary, e.g. qemu-riscv64
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <history.csv> <benchmark binary> [benchmark arguments]" >&2
+    exit 1
+fi
+
+HISTORY=$1
+BINARY=$2
+shift 2
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+if [ -z "$COMMIT" ]; then
+    COMMIT=$(git -C "$DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)
+    [ -n "$(git -C "$DIR" status --porcelain --untracked-files=no 2>/dev/null)" ] && COMMIT="$COMMIT-dirty"
+fi
+FLAGS=${FLAGS:-unknown}
+TARGET=${TARGET:-$(uname -m)}
+DATE=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+
+SAMPLES=$(mktemp)
+trap 'rm -f "$SAMPLES"' EXIT
+
+BENCH_SAMPLES=$SAMPLES $RUNNER "$BINARY" "$@" || exit 1
+if [ ! -s "$SAMPLES" ]; then
+    echo "The benchmark did not write any samples" >&2
+    exit 1
+fi
+
+[ -s "$HISTORY" ] || echo "date,commit,variant,flags,target,metric,repetition,value" > "$HISTORY"
+awk -F'\t' -v date="$DATE" -v commit="$COMMIT" -v variant="$VARIANT" \
+    -v flags="$FLAGS" -v target="$TARGET" '
+    {
+        name = variant != "" ? variant : $1
+        repetition[name, $2]++
+        printf "%s,%s,%s,\"%s\",%s,%s,%d,%s\n", date, commit, name, flags,
+               target, $2, repetition[name, $2], $3
+    }' "$SAMPLES" >> "$HISTORY"
+
+echo "Recorded $(wc -l < "$SAMPLES") samples of $COMMIT in $HISTORY"
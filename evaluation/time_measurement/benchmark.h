@@ -0,0 +1,471 @@
+#ifndef CRC_BENCHMARK_H
+#define CRC_BENCHMARK_H
+
+// Benchmark harness shared by unoptimized_crc.c and optimized_crc.c.
+//
+// The inputs are parsed into memory before anything is timed, so only the
+// CRC calls are measured, and every result is folded into a checksum that is
+// printed at the end, so the compiler can not delete the calls. Every
+// repetition runs all inputs once; the reported numbers are the minimum,
+// median and standard deviation over the repetitions.
+//
+// On Linux the hardware performance counters of the CPU are read around every
+// repetition as well (cycles, instructions, branches, branch misses and L1D
+// read misses, user space only), so the report shows why one variant is
+// faster and not only by how much. Counters the kernel or the CPU does not
+// provide (containers, VMs, perf_event_paranoid) are left out of the report;
+// -DBENCH_NO_PERF leaves all of them out.
+//
+// When BENCH_SAMPLES names a file, the value of every repetition is appended
+// to it as "name<TAB>metric<TAB>value" lines, for record_results.sh of
+// evaluation/regression_detection.
+//
+// That measures the throughput of independent calls. The distribution of the
+// cost of a single call is measured too, in two modes: independent calls,
+// and a dependent chain where every CRC is the input of the next call, which
+// is the latency a single CRC update adds to the code waiting for it. Calls
+// are timed in batches of BENCH_BATCH (a timestamp per call would cost more
+// than the call), and p50/p90/p99 over all batches are reported.
+
+#define _POSIX_C_SOURCE 199309L
+#define _DEFAULT_SOURCE
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "inputs_format.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__) && !defined(BENCH_NO_PERF)
+#define BENCH_PERF 1
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#define BENCH_DEFAULT_INPUTS "inputs.txt"
+#define BENCH_DEFAULT_REPETITIONS 15
+#define BENCH_BATCH 8
+
+// What parse_arguments has asked RUN_CRC_BENCHMARK to measure
+#define BENCH_THROUGHPUT 1
+#define BENCH_INDEPENDENT 2
+#define BENCH_DEPENDENT 4
+static int bench_mode = BENCH_THROUGHPUT;
+
+struct crc_inputs {
+  size_t count;
+  unsigned char *data;
+  unsigned short *crc;
+  // The mapped file for binary inputs, which data and crc point into
+  void *mapping;
+  size_t mapping_size;
+};
+
+// Map a binary pairs file of generate_inputs --binary, so that the inputs are
+// used in place instead of being parsed. Returns 1 if path is not one.
+static int map_inputs(const char *path, struct crc_inputs *in) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+
+  struct crc_inputs_header header;
+  struct stat st;
+  if (read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+      memcmp(header.magic, CRC_INPUTS_MAGIC, sizeof(header.magic))) {
+    close(fd);
+    return 1;
+  }
+  if (header.kind != CRC_INPUTS_PAIRS || fstat(fd, &st) ||
+      (uint64_t)st.st_size < crc_inputs_file_size(header.count, header.kind)) {
+    close(fd);
+    return -1;
+  }
+
+  in->mapping_size = st.st_size;
+  in->mapping = mmap(NULL, in->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (in->mapping == MAP_FAILED)
+    return -1;
+
+  // The crc array is little endian, like the hosts the benchmark runs on
+  unsigned char *base = in->mapping;
+  in->count = header.count;
+  in->data = base + sizeof(header);
+  in->crc = (unsigned short *)(base + crc_inputs_crc_offset(header.count));
+  return 0;
+}
+
+// Read the "data crc" pairs written by generate_inputs, as text or binary.
+static int load_inputs(const char *path, struct crc_inputs *in) {
+  in->mapping = NULL;
+  int mapped = map_inputs(path, in);
+  if (mapped <= 0)
+    return mapped == 0 && in->count ? 0 : -1;
+
+  FILE *fin = fopen(path, "r");
+  if (fin == NULL)
+    return -1;
+
+  size_t capacity = 1024;
+  in->count = 0;
+  in->data = malloc(capacity);
+  in->crc = malloc(capacity * sizeof(*in->crc));
+
+  int data, crc;
+  while (fscanf(fin, "%d %d", &data, &crc) == 2) {
+    if (in->count == capacity) {
+      capacity *= 2;
+      in->data = realloc(in->data, capacity);
+      in->crc = realloc(in->crc, capacity * sizeof(*in->crc));
+    }
+    in->data[in->count] = (unsigned char)data;
+    in->crc[in->count] = (unsigned short)crc;
+    in->count++;
+  }
+
+  fclose(fin);
+  return in->count ? 0 : -1;
+}
+
+static void free_inputs(struct crc_inputs *in) {
+  if (in->mapping) {
+    munmap(in->mapping, in->mapping_size);
+  } else {
+    free(in->data);
+    free(in->crc);
+  }
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Cycle counter: the TSC on x86 (which ticks at a constant reference rate,
+// not necessarily the core clock), the cycle CSR on RISC-V. Returns 0 where
+// there is none, or when built with -DBENCH_NO_CYCLES, e.g. on RISC-V
+// kernels that do not let user space read the cycle CSR.
+static uint64_t read_cycles(void) {
+#if defined(BENCH_NO_CYCLES)
+  return 0;
+#elif defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__riscv) && __riscv_xlen == 64
+  uint64_t cycles;
+  __asm__ volatile("rdcycle %0" : "=r"(cycles));
+  return cycles;
+#else
+  return 0;
+#endif
+}
+
+#define PERF_MAX_COUNTERS 5
+
+// The counters that could be opened, as one group so they all count over
+// exactly the same instructions.
+struct perf_counters {
+  int count;
+  int fds[PERF_MAX_COUNTERS];
+  const char *labels[PERF_MAX_COUNTERS];
+};
+
+#ifdef BENCH_PERF
+static int open_perf_counter(uint32_t type, uint64_t config, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = group_fd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+// Open the counters that are available. Prints why when there are none.
+static void perf_counters_open(struct perf_counters *pc) {
+  pc->count = 0;
+#ifdef BENCH_PERF
+  static const struct {
+    const char *label;
+    uint32_t type;
+    uint64_t config;
+  } events[PERF_MAX_COUNTERS] = {
+      {"cycles/call", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {"instr/call", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {"branches/call", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+      {"br-misses/call", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {"l1d-miss/call", PERF_TYPE_HW_CACHE,
+       PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+           PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+  };
+  int error = 0;
+  for (int i = 0; i < PERF_MAX_COUNTERS; i++) {
+    int fd = open_perf_counter(events[i].type, events[i].config,
+                               pc->count ? pc->fds[0] : -1);
+    if (fd < 0) {
+      error = errno;
+      continue;
+    }
+    pc->fds[pc->count] = fd;
+    pc->labels[pc->count] = events[i].label;
+    pc->count++;
+  }
+  if (!pc->count)
+    printf("  perf counters unavailable: %s\n", strerror(error));
+#else
+  printf("  perf counters unavailable: not supported on this platform\n");
+#endif
+}
+
+// Read the current values of all counters into values[0..count).
+static void perf_counters_read(const struct perf_counters *pc,
+                               uint64_t *values) {
+#ifdef BENCH_PERF
+  uint64_t buffer[1 + PERF_MAX_COUNTERS];
+  if (pc->count &&
+      read(pc->fds[0], buffer, sizeof(buffer)) >= (ssize_t)sizeof(uint64_t)) {
+    memcpy(values, buffer + 1, pc->count * sizeof(uint64_t));
+    return;
+  }
+#endif
+  memset(values, 0, pc->count * sizeof(uint64_t));
+}
+
+static void perf_counters_enable(const struct perf_counters *pc) {
+#ifdef BENCH_PERF
+  if (pc->count)
+    ioctl(pc->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+static void perf_counters_close(struct perf_counters *pc) {
+#ifdef BENCH_PERF
+  for (int i = 0; i < pc->count; i++)
+    close(pc->fds[i]);
+#endif
+  pc->count = 0;
+}
+
+// Timestamp for timing a few calls: the cycle counter, ordered with the
+// surrounding instructions on x86, or the monotonic clock where there is no
+// cycle counter.
+static double read_timestamp(void) {
+#if defined(BENCH_NO_CYCLES)
+  return now_ns();
+#elif defined(__x86_64__) || defined(__i386__)
+  _mm_lfence();
+  uint64_t tsc = __rdtsc();
+  _mm_lfence();
+  return (double)tsc;
+#else
+  uint64_t cycles = read_cycles();
+  return cycles ? (double)cycles : now_ns();
+#endif
+}
+
+// Append values[0..n) divided by scale to the BENCH_SAMPLES file, if any.
+static void write_samples(const char *name, const char *metric,
+                          const double *values, int n, double scale) {
+  const char *path = getenv("BENCH_SAMPLES");
+  FILE *f = path ? fopen(path, "a") : NULL;
+  if (!f)
+    return;
+  for (int i = 0; i < n; i++)
+    fprintf(f, "%s\t%s\t%.6f\n", name, metric, values[i] / scale);
+  fclose(f);
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Print min, median and standard deviation of values[0..n) divided by scale.
+static void print_statistics(const char *label, double *values, int n,
+                             double scale) {
+  double sum = 0, sum_sq = 0;
+  for (int i = 0; i < n; i++) {
+    values[i] /= scale;
+    sum += values[i];
+    sum_sq += values[i] * values[i];
+  }
+  qsort(values, n, sizeof(*values), compare_doubles);
+  double mean = sum / n;
+  double median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+  double stddev = n > 1 ? sqrt((sum_sq - n * mean * mean) / (n - 1)) : 0;
+  printf("  %-14s min %10.3f  median %10.3f  stddev %8.3f\n", label, values[0],
+         median, stddev);
+}
+
+static double percentile(const double *sorted, size_t n, double p) {
+  size_t rank = (size_t)ceil(p / 100 * n);
+  return sorted[rank ? rank - 1 : 0];
+}
+
+// Print p50, p90, p99 and max of values[0..n).
+static void print_percentiles(const char *label, double *values, size_t n) {
+  qsort(values, n, sizeof(*values), compare_doubles);
+  printf("  %-14s p50 %10.3f  p90 %10.3f  p99 %10.3f  max %10.3f\n", label,
+         percentile(values, n, 50), percentile(values, n, 90),
+         percentile(values, n, 99), values[n - 1]);
+}
+
+// Cost of taking two timestamps with nothing in between, which is
+// subtracted from every timed batch.
+static double timestamp_overhead(void) {
+  double samples[1001];
+  for (int i = 0; i < 1001; i++) {
+    double start = read_timestamp();
+    samples[i] = read_timestamp() - start;
+  }
+  qsort(samples, 1001, sizeof(*samples), compare_doubles);
+  return samples[500];
+}
+
+// Time repetitions passes of crc_fn over all inputs and print the results.
+// A macro rather than a function taking a function pointer, so that the CRC
+// function is called directly, exactly as in the original measurement loop.
+// Each call consumes one byte of data, so cycles/byte equals cycles/call.
+// The counters are read outside of the timed region, so reading them does
+// not add to ns/call.
+#define RUN_CRC_THROUGHPUT(name, crc_fn, in, repetitions)                     \
+  do {                                                                         \
+    struct perf_counters pc_;                                                  \
+    double *ns_ = malloc((repetitions) * sizeof(double));                      \
+    double *cycles_ = malloc((repetitions) * sizeof(double));                  \
+    double *counts_ = malloc((repetitions) * PERF_MAX_COUNTERS *               \
+                             sizeof(double));                                  \
+    uint64_t before_[PERF_MAX_COUNTERS], after_[PERF_MAX_COUNTERS];            \
+    unsigned checksum_ = 0;                                                    \
+    printf("%s: %zu calls x %d repetitions\n", (name), (in).count,             \
+           (repetitions));                                                     \
+    perf_counters_open(&pc_);                                                  \
+    perf_counters_enable(&pc_);                                                \
+    for (int r_ = 0; r_ < (repetitions); r_++) {                               \
+      perf_counters_read(&pc_, before_);                                       \
+      double start_ns_ = now_ns();                                             \
+      uint64_t start_cycles_ = read_cycles();                                  \
+      for (size_t i_ = 0; i_ < (in).count; i_++)                               \
+        checksum_ += crc_fn((in).data[i_], (in).crc[i_]);                      \
+      cycles_[r_] = (double)(read_cycles() - start_cycles_);                   \
+      ns_[r_] = now_ns() - start_ns_;                                          \
+      perf_counters_read(&pc_, after_);                                        \
+      for (int c_ = 0; c_ < pc_.count; c_++)                                   \
+        counts_[c_ * (repetitions) + r_] = (double)(after_[c_] - before_[c_]); \
+    }                                                                          \
+    write_samples((name), "ns/call", ns_, (repetitions), (double)(in).count);  \
+    if (cycles_[0] != 0)                                                       \
+      write_samples((name), "cycles/byte", cycles_, (repetitions),             \
+                    (double)(in).count);                                       \
+    print_statistics("ns/call", ns_, (repetitions), (double)(in).count);       \
+    if (cycles_[0] != 0)                                                       \
+      print_statistics("cycles/byte", cycles_, (repetitions),                  \
+                       (double)(in).count);                                    \
+    for (int c_ = 0; c_ < pc_.count; c_++)                                     \
+      print_statistics(pc_.labels[c_], counts_ + c_ * (repetitions),           \
+                       (repetitions), (double)(in).count);                     \
+    printf("  checksum       %u\n", checksum_);                                \
+    perf_counters_close(&pc_);                                                 \
+    free(ns_);                                                                 \
+    free(cycles_);                                                             \
+    free(counts_);                                                             \
+  } while (0)
+
+// Time crc_fn in batches of BENCH_BATCH calls and print the distribution of
+// the cost of a call. With dependent set every call takes the CRC the
+// previous call returned, so a batch takes the latency of its calls; without
+// it the calls are independent and may overlap.
+#define RUN_CRC_DISTRIBUTION(name, crc_fn, in, repetitions, dependent)        \
+  do {                                                                         \
+    size_t batches_ = (in).count / BENCH_BATCH;                                \
+    size_t n_ = batches_ * (repetitions);                                      \
+    double *samples_ = malloc((n_ ? n_ : 1) * sizeof(double));                 \
+    double overhead_ = timestamp_overhead();                                   \
+    unsigned checksum_ = 0;                                                    \
+    unsigned short chain_ = (in).crc[0];                                       \
+    printf("%s, %s calls: %zu batches of %d x %d repetitions\n", (name),      \
+           (dependent) ? "dependent" : "independent", batches_, BENCH_BATCH,   \
+           (repetitions));                                                     \
+    for (int r_ = 0; r_ < (repetitions); r_++) {                               \
+      for (size_t b_ = 0; b_ < batches_; b_++) {                               \
+        const unsigned char *data_ = (in).data + b_ * BENCH_BATCH;             \
+        const unsigned short *crc_ = (in).crc + b_ * BENCH_BATCH;              \
+        double start_ = read_timestamp();                                      \
+        if (dependent)                                                         \
+          for (int k_ = 0; k_ < BENCH_BATCH; k_++)                             \
+            chain_ = crc_fn(data_[k_], chain_);                                \
+        else                                                                   \
+          for (int k_ = 0; k_ < BENCH_BATCH; k_++)                             \
+            checksum_ += crc_fn(data_[k_], crc_[k_]);                          \
+        double elapsed_ = read_timestamp() - start_ - overhead_;               \
+        samples_[r_ * batches_ + b_] =                                         \
+            elapsed_ > 0 ? elapsed_ / BENCH_BATCH : 0;                         \
+      }                                                                        \
+    }                                                                          \
+    if (n_)                                                                    \
+      print_percentiles(read_cycles() ? "cycles/call" : "ns/call", samples_,   \
+                        n_);                                                   \
+    printf("  checksum       %u\n", (dependent) ? chain_ : checksum_);         \
+    free(samples_);                                                            \
+  } while (0)
+
+// Run the measurements parse_arguments has selected.
+#define RUN_CRC_BENCHMARK(name, crc_fn, in, repetitions)                      \
+  do {                                                                         \
+    if (bench_mode & BENCH_THROUGHPUT)                                         \
+      RUN_CRC_THROUGHPUT(name, crc_fn, in, repetitions);                       \
+    if (bench_mode & BENCH_INDEPENDENT)                                        \
+      RUN_CRC_DISTRIBUTION(name, crc_fn, in, repetitions, 0);                  \
+    if (bench_mode & BENCH_DEPENDENT)                                          \
+      RUN_CRC_DISTRIBUTION(name, crc_fn, in, repetitions, 1);                  \
+  } while (0)
+
+// Parse "[inputs file] [repetitions] [mode]" from the command line, where
+// mode is throughput (the default), independent, dependent or all.
+static int parse_arguments(int argc, char **argv, struct crc_inputs *in,
+                           int *repetitions) {
+  const char *path = argc > 1 ? argv[1] : BENCH_DEFAULT_INPUTS;
+  *repetitions = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_REPETITIONS;
+  const char *mode = argc > 3 ? argv[3] : "throughput";
+  if (!strcmp(mode, "throughput"))
+    bench_mode = BENCH_THROUGHPUT;
+  else if (!strcmp(mode, "independent"))
+    bench_mode = BENCH_INDEPENDENT;
+  else if (!strcmp(mode, "dependent"))
+    bench_mode = BENCH_DEPENDENT;
+  else if (!strcmp(mode, "all"))
+    bench_mode = BENCH_THROUGHPUT | BENCH_INDEPENDENT | BENCH_DEPENDENT;
+  else
+    bench_mode = 0;
+  if (*repetitions <= 0 || !bench_mode) {
+    fprintf(stderr,
+            "Usage: %s [inputs file] [repetitions] "
+            "[throughput|independent|dependent|all]\n",
+            argv[0]);
+    return -1;
+  }
+  if (load_inputs(path, in)) {
+    fprintf(stderr, "Could not read inputs from %s\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+#endif // CRC_BENCHMARK_H
@@ -1,30 +1,196 @@
-#include <iostream>
-#include <cstdlib>
+// Generates the inputs of the CRC benchmark.
+//
+//   generate_inputs <count> [options]
+//     --seed <n>      seed of the generator (default 1); the same seed gives
+//                     the same inputs, no matter the number of threads
+//     --binary        write (data, crc) pairs in the binary format of
+//                     inputs_format.h instead of text
+//     --raw           write one buffer of count random bytes (binary format)
+//     --threads <n>   threads generating and writing blocks of the file
+//                     (default: all cores)
+//     -o <file>       output file (default: inputs.txt, inputs.bin for
+//                     --binary and --raw)
+//
+// The inputs are split into blocks of a million, every block has its own
+// splitmix64 stream derived from the seed and the block number, so blocks
+// can be generated and written in parallel, straight to their place in the
+// file.
+
+#include <cstdint>
 #include <cstdio>
-#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "inputs_format.h"
 
 using namespace std;
 
+static const uint64_t BlockSize = 1 << 20;
+
+static uint64_t splitmix64(uint64_t &state){
+    uint64_t z = (state += 0x9e3779b97f4a7c15u);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+    return z ^ (z >> 31);
+}
+
+static uint64_t blockState(uint64_t seed, uint64_t block){
+    uint64_t state = seed ^ (block * 0xd1b54a32d192ed03u);
+    return splitmix64(state);
+}
+
+// Fill data[0..n) and, when crc is given, crc[0..n) for the block
+static void generateBlock(uint64_t seed, uint64_t block, unsigned char *data, uint16_t *crc, uint64_t n){
+    uint64_t state = blockState(seed, block);
+    uint64_t i = 0;
+    if(crc){
+        // One draw gives the data byte and the crc of two pairs
+        for(; i < n; i += 2){
+            uint64_t r = splitmix64(state);
+            data[i] = r & 0xff;
+            crc[i] = r >> 16 & 0xffff;
+            if(i + 1 < n){
+                data[i + 1] = r >> 8 & 0xff;
+                crc[i + 1] = r >> 32 & 0xffff;
+            }
+        }
+    } else {
+        for(; i + 8 <= n; i += 8){
+            uint64_t r = splitmix64(state);
+            memcpy(data + i, &r, 8);
+        }
+        uint64_t r = splitmix64(state);
+        for(; i < n; i++, r >>= 8)
+            data[i] = r & 0xff;
+    }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    if(crc)
+        for(uint64_t j = 0; j < n; j++)
+            crc[j] = __builtin_bswap16(crc[j]);
+#endif
+}
+
+static bool writeAll(int fd, const void *buf, size_t len, off_t offset){
+    const char *p = static_cast<const char *>(buf);
+    while(len){
+        ssize_t written = pwrite(fd, p, len, offset);
+        if(written <= 0)
+            return false;
+        p += written; len -= written; offset += written;
+    }
+    return true;
+}
+
+static int writeBinary(const string &path, uint64_t count, uint32_t kind, uint64_t seed, unsigned threads){
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0 || ftruncate(fd, crc_inputs_file_size(count, kind)) != 0){
+        cerr << "Could not create " << path << "\n";
+        return 1;
+    }
+
+    struct crc_inputs_header header = {};
+    memcpy(header.magic, CRC_INPUTS_MAGIC, sizeof(header.magic));
+    header.count = count;
+    header.kind = kind;
+    header.version = 1;
+    header.seed = seed;
+    bool ok = writeAll(fd, &header, sizeof(header), 0);
+
+    uint64_t blocks = (count + BlockSize - 1) / BlockSize;
+    vector<thread> workers;
+    vector<char> failed(threads);
+    for(unsigned t = 0; t < threads; t++){
+        workers.emplace_back([&, t]{
+            vector<unsigned char> data(BlockSize);
+            vector<uint16_t> crc(kind == CRC_INPUTS_PAIRS ? BlockSize : 0);
+            for(uint64_t block = t; block < blocks; block += threads){
+                uint64_t first = block * BlockSize;
+                uint64_t n = min(BlockSize, count - first);
+                generateBlock(seed, block, data.data(), crc.empty() ? nullptr : crc.data(), n);
+                if(!writeAll(fd, data.data(), n, sizeof(header) + first))
+                    failed[t] = 1;
+                if(!crc.empty() && !writeAll(fd, crc.data(), 2 * n, crc_inputs_crc_offset(count) + 2 * first))
+                    failed[t] = 1;
+            }
+        });
+    }
+    for(thread &worker : workers)
+        worker.join();
+    for(char f : failed)
+        ok &= !f;
+
+    if(close(fd) != 0 || !ok){
+        cerr << "Could not write " << path << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+static int writeText(const string &path, uint64_t count, uint64_t seed){
+    FILE *f = fopen(path.c_str(), "w");
+    if(f == NULL){
+        cerr << "Could not create " << path << "\n";
+        return 1;
+    }
+
+    vector<unsigned char> data(BlockSize);
+    vector<uint16_t> crc(BlockSize);
+    for(uint64_t block = 0; block * BlockSize < count; block++){
+        uint64_t n = min(BlockSize, count - block * BlockSize);
+        generateBlock(seed, block, data.data(), crc.data(), n);
+        for(uint64_t i = 0; i < n; i++)
+            fprintf(f, "%d %d\n", data[i], crc[i]);
+    }
+    return fclose(f) == 0 ? 0 : 1;
+}
+
 int main(int argc, char **argv){
-    if(argc==1){
-        cerr << "Please provide the test size!\n";
+    if(argc < 2){
+        cerr << "Usage: " << argv[0] << " <count> [--seed n] [--binary | --raw] [--threads n] [-o file]\n";
         exit(1);
     }
-    
-    long test_size=atoi(argv[1]);
-    unsigned char data; 
-    unsigned short crc; 
-    srand(time(NULL));
-    
-    cout << "Test size is equal to: " << test_size << endl;
-    FILE *f=fopen("inputs.txt", "w");
 
-    for(long i=0;i<test_size;i++){
-        data=rand()%256; crc=rand()%65536;
-        fprintf(f, "%d %d\n", data, crc);
+    uint64_t count = strtoull(argv[1], NULL, 0);
+    uint64_t seed = 1;
+    bool binary = false, raw = false;
+    unsigned threads = thread::hardware_concurrency();
+    string path;
+    for(int i = 2; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--seed" && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if(arg == "--binary")
+            binary = true;
+        else if(arg == "--raw")
+            raw = true;
+        else if(arg == "--threads" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(arg == "-o" && i + 1 < argc)
+            path = argv[++i];
+        else {
+            cerr << "Unknown argument " << arg << "\n";
+            exit(1);
+        }
     }
-    cout << "End of initialization. Test cases are generated." << endl;
-    fclose(f);
+    if(count == 0 || (binary && raw)){
+        cerr << "Please provide a positive test size and at most one of --binary and --raw!\n";
+        exit(1);
+    }
+    if(threads == 0)
+        threads = 1;
+    if(path.empty())
+        path = binary || raw ? "inputs.bin" : "inputs.txt";
 
-    return 0;
-}
\ No newline at end of file
+    cout << "Test size is equal to: " << count << ", seed " << seed << endl;
+    int result = binary || raw ? writeBinary(path, count, raw ? CRC_INPUTS_RAW : CRC_INPUTS_PAIRS, seed, threads)
+                               : writeText(path, count, seed);
+    if(result == 0)
+        cout << "End of initialization. Test cases are written to " << path << "." << endl;
+    return result;
+}
@@ -0,0 +1,40 @@
+#ifndef CRC_INPUTS_FORMAT_H
+#define CRC_INPUTS_FORMAT_H
+
+// Binary inputs files written by generate_inputs --binary or --raw. The file
+// is laid out so that it can be mapped and used in place:
+//
+//   header            struct crc_inputs_header, 64 bytes
+//   data              count bytes
+//   crc (pairs only)  count little endian uint16_t, from the first multiple
+//                     of 64 after the data
+//
+// A pairs file holds the (data, crc) pairs of inputs.txt, a raw file one
+// buffer of count bytes.
+
+#include <stdint.h>
+
+#define CRC_INPUTS_MAGIC "CRCINPUT"
+#define CRC_INPUTS_PAIRS 0
+#define CRC_INPUTS_RAW 1
+
+struct crc_inputs_header {
+  char magic[8];
+  uint64_t count;
+  uint32_t kind;
+  uint32_t version;
+  uint64_t seed;
+  uint8_t reserved[32];
+};
+
+static inline uint64_t crc_inputs_crc_offset(uint64_t count) {
+  return (sizeof(struct crc_inputs_header) + count + 63) / 64 * 64;
+}
+
+static inline uint64_t crc_inputs_file_size(uint64_t count, uint32_t kind) {
+  if (kind == CRC_INPUTS_RAW)
+    return sizeof(struct crc_inputs_header) + count;
+  return crc_inputs_crc_offset(count) + 2 * count;
+}
+
+#endif // CRC_INPUTS_FORMAT_H
@@ -1,6 +1,4 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
+#include "benchmark.h"
 
 unsigned short crcu8_optimized(unsigned char data, unsigned short _crc)  {
     unsigned char i = 0, x16 = 0, carry = 0;
@@ -16,32 +14,18 @@ unsigned short crcu8_optimized(unsigned char data, unsigned short _crc)  {
 }
 
 
-int main(){
+int main(int argc, char **argv){
 
-  int data;
-  int crc;
-  unsigned short report;
+  struct crc_inputs inputs;
+  int repetitions;
 
-  FILE *fin=fopen("inputs.txt", "r");
-  if(fin==NULL){
+  if(parse_arguments(argc, argv, &inputs, &repetitions)){
     return -1;
   }
 
-  // Start measuring time
-  clock_t start_time = clock();
+  RUN_CRC_BENCHMARK("crcu8_optimized", crcu8_optimized, inputs, repetitions);
 
-  while(fscanf(fin, "%d %d", &data, &crc)!=EOF){
-    report=crcu8_optimized(data, crc);
-  }
-
-  // Stop measuring time
-  clock_t end_time = clock();
-
-  // Calculate the elapsed time in milliseconds
-  double elapsed_time = (double)(end_time - start_time) * 1000.0 / CLOCKS_PER_SEC;
-  printf("Execution time: %.3f ms\n", elapsed_time);
+  free_inputs(&inputs);
 
-  fclose(fin);
-   
-  return 0; 
+  return 0;
 }
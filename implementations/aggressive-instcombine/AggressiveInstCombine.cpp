@@ -2246,48 +2246,45 @@ static bool foldUnusualPatterns(Function &F, DominatorTree &DT,
     errs() << "Sorry, but you can't use both options for crc algorithm recognition!\n";
   }
 
-  Module *M=F.getParent();
-  for(Function &F: *M){
-    for (BasicBlock &BB : F) {
-      // Ignore unreachable basic blocks.
-      if (!DT.isReachableFromEntry(&BB))
-        continue;
+  // Only F is looked at: DT and the other analyses belong to F, and the pass
+  // manager runs this pass on every function of the module anyway.
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  for (BasicBlock &BB : F) {
+    // Ignore unreachable basic blocks.
+    if (!DT.isReachableFromEntry(&BB))
+      continue;
+
+    // Walk the block backwards for efficiency. We're matching a chain of
+    // use->defs, so we're more likely to succeed by starting from the bottom.
+    // Also, we want to avoid matching partial patterns.
+    // TODO: It would be more efficient if we removed dead instructions
+    // iteratively in this loop rather than waiting until the end.
+    for (Instruction &I : make_early_inc_range(llvm::reverse(BB))) {
+      MadeChange |= foldAnyOrAllBitsSet(I);
+      MadeChange |= foldGuardedFunnelShift(I, DT);
+      MadeChange |= tryToRecognizePopCount(I);
       
-      //errs() << "Hello from here!" << "\n";
-      const DataLayout &DL = F.getParent()->getDataLayout();
-
-      // Walk the block backwards for efficiency. We're matching a chain of
-      // use->defs, so we're more likely to succeed by starting from the bottom.
-      // Also, we want to avoid matching partial patterns.
-      // TODO: It would be more efficient if we removed dead instructions
-      // iteratively in this loop rather than waiting until the end.
-      for (Instruction &I : make_early_inc_range(llvm::reverse(BB))) {
-        MadeChange |= foldAnyOrAllBitsSet(I);
-        MadeChange |= foldGuardedFunnelShift(I, DT);
-        MadeChange |= tryToRecognizePopCount(I);
-        
-        //bool flag1=tryToRecognizeTableBasedCRC32(I);
-        //MadeChange |= flag1;
-        //if(flag1)
-        //  errs() << "Function we have created seems to work properly!\n";
-
-        MadeChange |= tryToFPToSat(I, TTI);
-        //MadeChange |= tryToRecognizeTableBasedCttz(I);
-        bool recognised=tryToRecognizeTableBasedCttz(I);
-        if(recognised){
-          MadeChange |=recognised;
-          //errs() << "Mission completed!" << "\n";
-        } else {
-          MadeChange |=recognised;
-          //errs() << "Mission is still not completed!" << "\n";
-        }
-        MadeChange |= foldConsecutiveLoads(I, DL, TTI, AA, DT);
-        MadeChange |= foldPatternedLoads(I, DL);
-        // NOTE: This function introduces erasing of the instruction `I`, so it
-        // needs to be called at the end of this sequence, otherwise we may make
-        // bugs.
-        MadeChange |= foldSqrt(I, TTI, TLI);
+      //bool flag1=tryToRecognizeTableBasedCRC32(I);
+      //MadeChange |= flag1;
+      //if(flag1)
+      //  errs() << "Function we have created seems to work properly!\n";
+
+      MadeChange |= tryToFPToSat(I, TTI);
+      //MadeChange |= tryToRecognizeTableBasedCttz(I);
+      bool recognised=tryToRecognizeTableBasedCttz(I);
+      if(recognised){
+        MadeChange |=recognised;
+        //errs() << "Mission completed!" << "\n";
+      } else {
+        MadeChange |=recognised;
+        //errs() << "Mission is still not completed!" << "\n";
       }
+      MadeChange |= foldConsecutiveLoads(I, DL, TTI, AA, DT);
+      MadeChange |= foldPatternedLoads(I, DL);
+      // NOTE: This function introduces erasing of the instruction `I`, so it
+      // needs to be called at the end of this sequence, otherwise we may make
+      // bugs.
+      MadeChange |= foldSqrt(I, TTI, TLI);
     }
   }
   // We're done with transforms, so remove dead instructions.
@@ -21,6 +21,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/CRCDescriptor.h"
 #include <optional>
 #include <vector>
 
@@ -829,45 +830,6 @@ bool RISCVDAGToDAGISel::tryIndexedLoad(SDNode *Node) {
   return true;
 }
 
-// Returns the quotient of polynomial long division of x^2n by POLYNOMIAL in
-// GF(2^n).
-unsigned create_quotient(unsigned polynomial, size_t n) {
-  std::vector<short> x2n;
-  std::vector<bool> pol, q;
-  // Create vector of bits, for the polynomial.
-  for (size_t i = 0; i < n; i++) {
-    pol.push_back(polynomial & 1);
-    polynomial >>= 1;
-  }
-  pol.push_back(1);
-
-  // Create vector for x^2n polynomial.
-  for (size_t i = 0; i < 2 * (n - 1); i++)
-    x2n.push_back(0);
-  x2n.push_back(1);
-
-  for (size_t i = 0; i < n; i++)
-    q.push_back(0);
-
-  // Calculate the quotient of x^2n/polynomial.
-  for (int i = n - 1; i >= 0; i--) {
-    int d = x2n[i + n - 1];
-    if (d == 0)
-      continue;
-    for (int j = i + n - 1; j >= i; j--)
-      x2n[j] = x2n[j] ^ (pol[j - i] * d);
-    q[i] = d;
-  }
-
-  // Get the number from the vector of 0/1s.
-  unsigned quotient = 0;
-  for (size_t i = 0; i < q.size(); i++) {
-    quotient <<= 1;
-    quotient = quotient | q[q.size() - i - 1];
-  }
-  return quotient;
-}
-
 void RISCVDAGToDAGISel::Select(SDNode *Node) {
   errs() << "We are inside RISCVDAGToDAGISel::Select function!\n";
   // If we have a custom node, we have already selected.
@@ -891,41 +853,65 @@ void RISCVDAGToDAGISel::Select(SDNode *Node) {
 
   switch (Opcode) {
   case RISCVISD::PSEUDO_CRC: {
-    errs() << "Januar 19th PETAR!\n";
-    // const uint polynomial = 0x04C11DB7;
-    const unsigned polynomial = 0x04C11DB7;
-    const unsigned crc_size = 32;
-    const unsigned GET_MODE_BITSIZE = 64;
-    const unsigned quotient = create_quotient(polynomial, crc_size + 1);
-    errs() << "polynomial = " << polynomial << "\n";
-    errs() << "quotient = " << quotient << "\n";
-    errs() << "crc_size = " << crc_size << "\n";
-    errs() << "GET_MODE_BITSIZE = " << GET_MODE_BITSIZE << "\n";
-    SDNode *NewNode1 = CurDAG->getMachineNode(
-        RISCV::XOR, DL, VT, Node->getOperand(1), Node->getOperand(0));
-    SDNode *NewNode2 =
-        CurDAG->getMachineNode(RISCV::CLMUL, DL, VT, SDValue(NewNode1, 0),
-                               CurDAG->getTargetConstant(quotient, DL, VT));
-    SDNode *NewNode3 =
-        CurDAG->getMachineNode(RISCV::SRLI, DL, VT, SDValue(NewNode2, 0),
-                               CurDAG->getTargetConstant(crc_size, DL, VT));
-    SDNode *NewNode4 =
-        CurDAG->getMachineNode(RISCV::CLMUL, DL, VT, SDValue(NewNode3, 0),
-                               CurDAG->getTargetConstant(polynomial, DL, VT));
-    SDNode *NewNode5 = CurDAG->getMachineNode(
-        RISCV::SLLI, DL, VT, SDValue(NewNode4, 0),
-        CurDAG->getTargetConstant(GET_MODE_BITSIZE - crc_size, DL, VT));
-    SDNode *NewNode6 = CurDAG->getMachineNode(
-        RISCV::SRLI, DL, VT, SDValue(NewNode5, 0),
-        CurDAG->getTargetConstant(GET_MODE_BITSIZE - crc_size, DL, VT));
-
-    /*
-    SDValue RetRegister = CurDAG->getRegister(RISCV::X1, VT);
-    SDNode *FinalNode = CurDAG->getMachineNode(RISCV::LD, DL, VT, RetRegister,
-                                               SDValue(NewNode6, 0));
-    */
-    ReplaceNode(Node, NewNode6);
-    // ReplaceNode(Node, FinalNode);
+    // One CRC step computed with two carry-less multiplications (Barrett
+    // reduction), with the constants taken from the CRC descriptor. Operand 0
+    // holds the data and operand 1 the CRC register; only their low DataWidth
+    // and Width bits are meaningful, the rest may be garbage.
+    const CRCDescriptor &Desc = getCRCU8Descriptor();
+    const CRCBarrettConstants Consts = getCRCBarrettConstants(Desc);
+    const unsigned XLen = Subtarget->getXLen();
+    const unsigned W = Desc.Width;
+    const unsigned K = Desc.DataWidth;
+    LLVM_DEBUG(dbgs() << "CRC step: quotient = " << Consts.Quotient
+                      << ", polynomial = " << Consts.Poly << "\n");
+
+    auto getBinOp = [&](unsigned Opc, SDValue LHS, SDValue RHS) {
+      return SDValue(CurDAG->getMachineNode(Opc, DL, VT, LHS, RHS), 0);
+    };
+    auto getShift = [&](unsigned Opc, SDValue Src, unsigned ShAmt) {
+      return getBinOp(Opc, Src, CurDAG->getTargetConstant(ShAmt, DL, VT));
+    };
+    // Keep only the low Bits bits of Src, unless the rest is known to be zero
+    // already (e.g. for zeroext arguments).
+    auto getLowBits = [&](SDValue Src, unsigned Bits) {
+      if (Bits >= XLen ||
+          CurDAG->MaskedValueIsZero(Src, APInt::getBitsSetFrom(XLen, Bits)))
+        return Src;
+      int64_t Mask = maskTrailingOnes<uint64_t>(Bits);
+      if (isInt<12>(Mask))
+        return getBinOp(RISCV::ANDI, Src,
+                        CurDAG->getTargetConstant(Mask, DL, VT));
+      return getShift(RISCV::SRLI, getShift(RISCV::SLLI, Src, XLen - Bits),
+                      XLen - Bits);
+    };
+
+    SDValue Data = Node->getOperand(0);
+    SDValue Crc = getLowBits(Node->getOperand(1), W);
+    SDValue Quotient = selectImm(CurDAG, DL, VT, Consts.Quotient, *Subtarget);
+    SDValue Poly = selectImm(CurDAG, DL, VT, Consts.Poly, *Subtarget);
+
+    SDValue Result;
+    if (Desc.RefIn) {
+      // t = (crc ^ data) mod x^K
+      // q = clmul(t, quotient) mod x^K
+      // crc' = (crc >> K) ^ (clmul(q, poly) >> K)
+      SDValue T = getLowBits(getBinOp(RISCV::XOR, Crc, Data), K);
+      SDValue Q = getLowBits(getBinOp(RISCV::CLMUL, T, Quotient), K);
+      SDValue Reduced = getShift(RISCV::SRLI, getBinOp(RISCV::CLMUL, Q, Poly), K);
+      Result = getBinOp(RISCV::XOR, getShift(RISCV::SRLI, Crc, K), Reduced);
+    } else {
+      // t = ((crc >> (W - K)) ^ data) mod x^K
+      // q = clmul(t, quotient) >> K
+      // crc' = ((crc << K) ^ clmul(q, poly)) mod x^W
+      SDValue T = getLowBits(
+          getBinOp(RISCV::XOR, getShift(RISCV::SRLI, Crc, W - K), Data), K);
+      SDValue Q = getShift(RISCV::SRLI, getBinOp(RISCV::CLMUL, T, Quotient), K);
+      Result = getLowBits(getBinOp(RISCV::XOR, getShift(RISCV::SLLI, Crc, K),
+                                   getBinOp(RISCV::CLMUL, Q, Poly)),
+                          W);
+    }
+
+    ReplaceNode(Node, Result.getNode());
     return;
   }
   case ISD::ZERO_EXTEND: {
@@ -1,5 +1,6 @@
 #include "llvm/Transforms/Utils/RecognizingCRC.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
@@ -7,6 +8,7 @@
 #include "llvm/Analysis/BasicAliasAnalysis.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
@@ -24,14 +26,31 @@
 #include "llvm/IR/IntrinsicsRISCV.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/ADT/Triple.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Analysis/Loads.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/VectorUtils.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Transforms/Utils/CRCDescriptor.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
 
 using namespace llvm;
 using namespace PatternMatch;
 using namespace llvm;
 
+#define DEBUG_TYPE "crc-recognition"
+
 // User defined option that can bi passed to opt for checking whether optimized implementation 
 // of CRC algorithm is already in use
 static cl::opt<bool> CheckForOptimizedCRC("check-crc-opt", cl::init(false), cl::Hidden, 
@@ -45,6 +64,57 @@ static cl::opt<bool> UseNaiveCRCOptimization("crc-opt", cl::init(false), cl::Hid
 static cl::opt<bool> UseIntrinsicsCRCOptimization("crc-opt-intrinsic", cl::init(false), cl::Hidden, 
                               cl::desc("running CRC algorithm optimization with intrinsic function usage"));
 
+// User defined option that can be passed to opt for computing the CRCs of many short messages
+// with one call of the bit-sliced CRC runtime (implementations/crc-runtime)
+static cl::opt<bool> UseBitslicedCRCBatches("crc-batch", cl::init(false), cl::Hidden,
+                              cl::desc("replacing loops over many short CRC messages with a bit-sliced runtime call"));
+
+// User defined option that can be passed to opt for updating CRCs over runs of zero bytes
+// with a call of the CRC runtime when the length of the run is only known at runtime
+static cl::opt<bool> UseCRCRuntimeForZeros("crc-zeros", cl::init(false), cl::Hidden,
+                              cl::desc("replacing CRC loops over zero bytes with a call of the CRC runtime"));
+
+// User defined option that can be passed to opt for bounding the longest message the bit-sliced
+// batch lowering accepts; loops over longer messages keep their per message CRC loops
+static cl::opt<unsigned> CRCBatchMaxLength("crc-batch-max-length", cl::init(64), cl::Hidden,
+                              cl::desc("the longest message (in bytes) handed to the bit-sliced CRC runtime"));
+
+// How the CRC loops the recognizer finds are lowered
+enum class CRCLowering {
+  // one llvm.riscv.crc.petar call per step, selected to carry-less
+  // multiplications when the target has them and to shifts and XORs otherwise
+  Intrinsic,
+  // calls of the CRC runtime (implementations/crc-runtime), which picks the
+  // best kernel for the CPU the program runs on
+  Libcall,
+  // byte-wise lookups in a 256 entry table shared by all functions and
+  // translation units that compute the same CRC
+  Table,
+};
+
+// User defined option that can be passed to opt for choosing how the recognized CRC loops are lowered
+static cl::opt<CRCLowering> CRCLoweringKind("crc-lowering", cl::init(CRCLowering::Intrinsic), cl::Hidden,
+                              cl::desc("lowering of the recognized CRC loops"),
+                              cl::values(clEnumValN(CRCLowering::Intrinsic, "intrinsic", "one CRC intrinsic call per step"),
+                                         clEnumValN(CRCLowering::Libcall, "libcall", "one call of the CRC runtime per buffer"),
+                                         clEnumValN(CRCLowering::Table, "table", "one table lookup per step")));
+
+// User defined option that can be passed to opt for keeping the steps of crcu16 and crcu32
+// (two and four calls of crcu8) apart instead of fusing them into one wide step
+static cl::opt<bool> FuseCRCSteps("crc-fuse-steps", cl::init(true), cl::Hidden,
+                              cl::desc("fusing CRC steps over the bytes of one value into one wide step"));
+
+// User defined option that can be passed to opt for limiting the number of instructions
+// crc-table-init interprets when it evaluates a table initialization at compile time
+static cl::opt<unsigned> CRCTableInitBudget("crc-table-init-budget", cl::init(1 << 20), cl::Hidden,
+                              cl::desc("the most instructions evaluated for one CRC table initialization"));
+
+// User defined option that can be passed to opt for replacing CRC table lookups with CRC steps on
+// targets other than RISC-V, whose backends cannot select the steps: every step that is not part of
+// a lowered loop has to be lowered again with -crc-lowering=table
+static cl::opt<bool> ReplaceCRCTableLookups("crc-table-steps", cl::init(false), cl::Hidden,
+                              cl::desc("replacing CRC table lookups with CRC steps on every target"));
+
 static bool checkForOptimizedCRCInstructions(Instruction &I){
   // TO-DO
   return false;
@@ -792,7 +862,1109 @@ static bool tryToRecognizeCRC32_v1(Instruction &I) {
   return true;
 }
 
+// Function attribute of the functions that only wrap a CRC step (crcu8 after
+// it has been recognized). markCRCStepWrapper sets it in the run on the
+// wrapper itself, so that the runs on its callers do not have to look at its
+// body. The wrapper still computes the step once the step has been lowered.
+static const char CRCStepWrapperAttr[] = "crc-step-wrapper";
+
+// Return the descriptor of the CRC step V computes, if V is a call of
+// llvm.riscv.crc.petar or of a function marked as a wrapper of it, otherwise
+// return nullptr.
+static const CRCDescriptor *getCRCStepDescriptor(const Value *V) {
+  const auto *CI = dyn_cast<CallInst>(V);
+  if (!CI || CI->arg_size() != 2)
+    return nullptr;
+  if (CI->getIntrinsicID() == Intrinsic::riscv_crc_petar)
+    return &getCRCU8Descriptor();
+  if (const Function *Callee = CI->getCalledFunction())
+    if (Callee->hasFnAttribute(CRCStepWrapperAttr))
+      return &getCRCU8Descriptor();
+  return nullptr;
+}
+
+// Return the constant value of a CRC operand. Besides plain constants this
+// looks through loads of local variables that were just assigned a constant,
+// which is how the arguments of crcu8 look in main at -O0:
+//   store i8 -15, ptr %data, align 1
+//   ...
+//   %0 = load i8, ptr %data, align 1
+static ConstantInt *getConstantCRCOperand(Value *V, AAResults &AA) {
+  if (auto *C = dyn_cast<ConstantInt>(V))
+    return C;
+
+  auto *LI = dyn_cast<LoadInst>(V);
+  if (!LI || !LI->isSimple())
+    return nullptr;
+
+  bool IsLoadCSE = false;
+  return dyn_cast_or_null<ConstantInt>(
+      FindAvailableLoadedValue(LI, AA, &IsLoadCSE));
+}
+
+// Evaluate CRC steps whose operands are known at compile time. Both the
+// llvm.riscv.crc.petar intrinsic and calls of functions that only wrap it
+// (crcu8 after it has been recognized) are folded, so crcu8(241, 40261) in
+// main of crc_algorithms/*.c costs nothing at runtime.
+static bool foldConstantCRCCalls(Function &F,
+                                 function_ref<AAResults &()> GetAA) {
+  bool Changed = false;
+
+  for (Instruction &I : make_early_inc_range(instructions(F))) {
+    const CRCDescriptor *Desc = getCRCStepDescriptor(&I);
+    if (!Desc)
+      continue;
+
+    auto *CI = cast<CallInst>(&I);
+
+    AAResults &AA = GetAA();
+    ConstantInt *Data = getConstantCRCOperand(CI->getArgOperand(0), AA);
+    ConstantInt *Crc = getConstantCRCOperand(CI->getArgOperand(1), AA);
+    if (!Data || !Crc)
+      continue;
+
+    APInt Result = evaluateCRCStep(*Desc, Data->getValue(), Crc->getValue());
+    CI->replaceAllUsesWith(ConstantInt::get(
+        CI->getType(), Result.zextOrTrunc(CI->getType()->getIntegerBitWidth())));
+    CI->eraseFromParent();
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+// Evaluate CRC loops that run over a constant global buffer, e.g. the CRC of
+// a constant header or magic value:
+//   for (i = 0; i < sizeof(Header); i++)
+//     crc = crcu8(Header[i], crc);
+// The loop has to be in SSA form (after mem2reg), so that the running CRC is
+// a header phi and the trip count is visible to ScalarEvolution. The value
+// the loop computes is forwarded to its users outside of the loop, the loop
+// itself is left for loop deletion to clean up.
+static bool foldCRCLoopsOverConstantBuffers(LoopInfo &LI, DominatorTree &DT,
+                                            ScalarEvolution &SE,
+                                            OptimizationRemarkEmitter &ORE) {
+  bool Changed = false;
+
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    BasicBlock *Preheader = L->getLoopPreheader();
+    BasicBlock *Latch = L->getLoopLatch();
+    if (!Preheader || !Latch || L->getExitingBlock() != Latch)
+      continue;
+
+    unsigned TripCount = SE.getSmallConstantTripCount(L);
+    if (!TripCount)
+      continue;
+
+    for (PHINode &Phi : L->getHeader()->phis()) {
+      // Check for the running CRC: %crc = phi i16 [ C, %ph ], [ %next, %latch ]
+      auto *Step = dyn_cast<IntrinsicInst>(Phi.getIncomingValueForBlock(Latch));
+      if (!Step || Step->getIntrinsicID() != Intrinsic::riscv_crc_petar ||
+          Step->getArgOperand(1) != &Phi ||
+          !DT.dominates(Step->getParent(), Latch))
+        continue;
+
+      auto *Init = dyn_cast<ConstantInt>(Phi.getIncomingValueForBlock(Preheader));
+      auto *Load = dyn_cast<LoadInst>(Step->getArgOperand(0));
+      if (!Init || !Load || !Load->isSimple() || !L->contains(Load))
+        continue;
+
+      // Check that the data comes from a constant global, one element per
+      // iteration, starting at a constant element.
+      auto *Ptr = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Load->getPointerOperand()));
+      if (!Ptr || Ptr->getLoop() != L || !Ptr->isAffine())
+        continue;
+
+      auto *Base = dyn_cast<SCEVUnknown>(SE.getPointerBase(Ptr));
+      auto *GV = Base ? dyn_cast<GlobalVariable>(Base->getValue()) : nullptr;
+      if (!GV || !GV->isConstant() || !GV->hasDefinitiveInitializer())
+        continue;
+
+      auto *Buffer = dyn_cast<ConstantDataSequential>(GV->getInitializer());
+      if (!Buffer || Buffer->getElementType() != Load->getType())
+        continue;
+
+      uint64_t ElementSize = Buffer->getElementByteSize();
+      auto *Start = dyn_cast<SCEVConstant>(SE.removePointerBase(Ptr->getStart()));
+      auto *Stride = dyn_cast<SCEVConstant>(Ptr->getStepRecurrence(SE));
+      if (!Start || !Stride || Stride->getAPInt() != ElementSize ||
+          Start->getAPInt().isNegative() ||
+          Start->getAPInt().urem(ElementSize) != 0)
+        continue;
+
+      uint64_t Begin = Start->getAPInt().getZExtValue() / ElementSize;
+      if (Begin + TripCount > Buffer->getNumElements())
+        continue;
+
+      APInt Result = evaluateCRCOverBuffer(getCRCU8Descriptor(), *Buffer, Begin,
+                                           TripCount, Init->getValue());
+      Constant *Folded = ConstantInt::get(Step->getType(), Result);
+      Step->replaceUsesWithIf(Folded, [L](Use &U) {
+        return !L->contains(cast<Instruction>(U.getUser()));
+      });
+      ORE.emit([&]() {
+        return OptimizationRemark(DEBUG_TYPE, "ConstantBufferFolded", Step)
+               << "CRC over constant buffer " << ore::NV("Buffer", GV->getName())
+               << " evaluated at compile time";
+      });
+      Changed = true;
+    }
+  }
+
+  return Changed;
+}
+
+// Return a constant struct crc_descriptor (see crc_runtime.h of the CRC
+// runtime) holding Desc, for passing Desc to the runtime library.
+static GlobalVariable *getCRCDescriptorGlobal(Module &M,
+                                              const CRCDescriptor &Desc) {
+  std::string Name;
+  raw_string_ostream OS(Name);
+  OS << "crc.descriptor." << Desc.Width << "." << format_hex(Desc.Poly, 2)
+     << "." << Desc.RefIn << Desc.RefOut << "." << format_hex(Desc.Init, 2)
+     << "." << format_hex(Desc.XorOut, 2);
+  OS.flush();
+  if (GlobalVariable *GV = M.getNamedGlobal(Name))
+    return GV;
+
+  LLVMContext &Ctx = M.getContext();
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  // { width, refin, refout, poly, init, xorout }
+  StructType *DescTy =
+      StructType::get(Int32Ty, Int32Ty, Int32Ty, Int64Ty, Int64Ty, Int64Ty);
+  Constant *Init = ConstantStruct::get(
+      DescTy, {ConstantInt::get(Int32Ty, Desc.Width),
+               ConstantInt::get(Int32Ty, Desc.RefIn),
+               ConstantInt::get(Int32Ty, Desc.RefOut),
+               ConstantInt::get(Int64Ty, Desc.Poly),
+               ConstantInt::get(Int64Ty, Desc.Init),
+               ConstantInt::get(Int64Ty, Desc.XorOut)});
+  auto *GV = new GlobalVariable(M, DescTy, /*isConstant=*/true,
+                                GlobalValue::PrivateLinkage, Init, Name);
+  GV->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+  return GV;
+}
+
+template <typename EntryT>
+static Constant *getCRCTableInitializer(LLVMContext &Ctx,
+                                        ArrayRef<uint64_t> Entries) {
+  SmallVector<EntryT, 256> Narrowed(Entries.begin(), Entries.end());
+  return ConstantDataArray::get(Ctx, ArrayRef<EntryT>(Narrowed));
+}
+
+// Return the table of a byte-wise implementation of Desc (see
+// computeCRCTable) with entries of type EltTy. The table is named after what
+// determines its contents, crc.table.<width>.<poly>.<refin>.<entry type>,
+// and is linkonce_odr in a comdat of the same name, so every function and
+// translation unit that computes the same CRC shares one copy after linking.
+// It is aligned to a cache line, so the 512 or 1024 bytes of a 16 or 32 bit
+// table take 8 or 16 lines, not one more.
+static GlobalVariable *getCRCTableGlobal(Module &M, const CRCDescriptor &Desc,
+                                         IntegerType *EltTy) {
+  std::string Name;
+  raw_string_ostream OS(Name);
+  OS << "crc.table." << Desc.Width << "." << format_hex(Desc.Poly, 2) << "."
+     << Desc.RefIn << "." << *EltTy;
+  OS.flush();
+  if (GlobalVariable *GV = M.getNamedGlobal(Name))
+    return GV;
+
+  uint64_t Entries[256];
+  computeCRCTable(Desc, Entries);
+  Constant *Init;
+  switch (EltTy->getBitWidth()) {
+  case 8:
+    Init = getCRCTableInitializer<uint8_t>(M.getContext(), Entries);
+    break;
+  case 16:
+    Init = getCRCTableInitializer<uint16_t>(M.getContext(), Entries);
+    break;
+  case 32:
+    Init = getCRCTableInitializer<uint32_t>(M.getContext(), Entries);
+    break;
+  default:
+    Init = getCRCTableInitializer<uint64_t>(M.getContext(), Entries);
+    break;
+  }
+
+  auto *GV = new GlobalVariable(M, Init->getType(), /*isConstant=*/true,
+                                GlobalValue::LinkOnceODRLinkage, Init, Name);
+  GV->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+  GV->setVisibility(GlobalValue::HiddenVisibility);
+  GV->setAlignment(Align(64));
+  if (Triple(M.getTargetTriple()).supportsCOMDAT())
+    GV->setComdat(M.getOrInsertComdat(Name));
+  return GV;
+}
+
+// The smallest of i8, i16, i32 and i64 that holds a Width bit register.
+static IntegerType *getCRCTableEntryType(LLVMContext &Ctx, unsigned Width) {
+  return Type::getIntNTy(Ctx, std::max(8u, unsigned(PowerOf2Ceil(Width))));
+}
+
+// With -crc-lowering=table, replace every eight bit CRC step with a lookup in
+// the shared table of its CRC:
+//   crc = (crc >> 8) ^ Table[(crc ^ data) & 0xff]
+// which is what targets without carry-less multiplication run fastest.
+static bool lowerCRCStepsToTableLookups(Function &F) {
+  bool Changed = false;
+  Module &M = *F.getParent();
+
+  for (Instruction &I : make_early_inc_range(instructions(F))) {
+    auto *Step = dyn_cast<IntrinsicInst>(&I);
+    if (!Step || Step->getIntrinsicID() != Intrinsic::riscv_crc_petar)
+      continue;
+    const CRCDescriptor &Desc = *getCRCStepDescriptor(Step);
+    auto *CrcTy = cast<IntegerType>(Step->getType());
+    if (Desc.DataWidth != 8 || Desc.Width < 8 ||
+        Desc.Width > CrcTy->getBitWidth())
+      continue;
+
+    IntegerType *EltTy = getCRCTableEntryType(M.getContext(), Desc.Width);
+    GlobalVariable *Table = getCRCTableGlobal(M, Desc, EltTy);
+
+    IRBuilder<> Builder(Step);
+    Value *Data = Builder.CreateZExtOrTrunc(Step->getArgOperand(0),
+                                            Builder.getInt8Ty());
+    Value *Crc = Step->getArgOperand(1);
+    if (Desc.Width < CrcTy->getBitWidth())
+      Crc = Builder.CreateAnd(Crc, maskTrailingOnes<uint64_t>(Desc.Width));
+
+    Value *Index, *Shifted;
+    if (Desc.RefIn) {
+      Index = Builder.CreateXor(Builder.CreateTrunc(Crc, Builder.getInt8Ty()),
+                                Data);
+      Shifted = Builder.CreateLShr(Crc, 8);
+    } else {
+      Index = Builder.CreateXor(
+          Builder.CreateTrunc(Builder.CreateLShr(Crc, Desc.Width - 8),
+                              Builder.getInt8Ty()),
+          Data);
+      Shifted = Builder.CreateShl(Crc, 8);
+      if (Desc.Width < CrcTy->getBitWidth())
+        Shifted = Builder.CreateAnd(Shifted,
+                                    maskTrailingOnes<uint64_t>(Desc.Width));
+    }
+
+    Value *Entry = Builder.CreateLoad(
+        EltTy,
+        Builder.CreateInBoundsGEP(Table->getValueType(), Table,
+                                  {Builder.getInt64(0),
+                                   Builder.CreateZExt(Index, Builder.getInt64Ty())}),
+        "crc.entry");
+    Value *Next = Builder.CreateXor(
+        Shifted, Builder.CreateZExtOrTrunc(Entry, CrcTy), "crc.next");
+    Step->replaceAllUsesWith(Next);
+    Step->eraseFromParent();
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+// Recognize the steps of byte-wise (Sarwate) implementations that look up a
+// constant CRC-16/ARC table, e.g. the table crc-table-init has evaluated:
+//   crc = (crc >> 8) ^ Table[(crc ^ data) & 0xff]
+// and replace them with llvm.riscv.crc.petar. The table is deleted by
+// crc-table-merge once no lookups are left.
+static bool replaceTableLookupsWithCRCSteps(Function &F,
+                                            OptimizationRemarkEmitter &ORE) {
+  bool Changed = false;
+  const CRCDescriptor &CRCU8 = getCRCU8Descriptor();
+
+  for (Instruction &I : make_early_inc_range(instructions(F))) {
+    Value *Crc, *Index, *Entry;
+    if (!match(&I, m_c_Xor(m_LShr(m_Value(Crc), m_SpecificInt(8)),
+                           m_Value(Entry))) ||
+        !I.getType()->isIntegerTy(16))
+      continue;
+
+    // Entry = load i16 Table[0][Index]
+    auto *Load = dyn_cast<LoadInst>(Entry);
+    auto *GEP = Load && Load->isSimple()
+                    ? dyn_cast<GetElementPtrInst>(Load->getPointerOperand())
+                    : nullptr;
+    auto *Table = GEP ? dyn_cast<GlobalVariable>(GEP->getPointerOperand())
+                      : nullptr;
+    if (!Table || !Table->isConstant() || !Table->hasDefinitiveInitializer() ||
+        GEP->getSourceElementType() != Table->getValueType() ||
+        GEP->getNumIndices() != 2 || !match(GEP->getOperand(1), m_Zero()))
+      continue;
+    auto *Entries = dyn_cast<ConstantDataArray>(Table->getInitializer());
+    std::optional<CRCDescriptor> Desc =
+        Entries && Entries->getElementType() == I.getType()
+            ? matchCRCTable(*Entries)
+            : std::nullopt;
+    if (!Desc || Desc->Width != CRCU8.Width || Desc->Poly != CRCU8.Poly ||
+        Desc->RefIn != CRCU8.RefIn)
+      continue;
+
+    // Index = zext (trunc Crc ^ Data) or zext ((Crc ^ zext Data) & 0xff)
+    Value *Data;
+    Index = GEP->getOperand(2);
+    match(Index, m_ZExt(m_Value(Index)));
+    if (!match(Index, m_c_Xor(m_Trunc(m_Specific(Crc)), m_Value(Data))) &&
+        !match(Index, m_And(m_c_Xor(m_Specific(Crc), m_ZExt(m_Value(Data))),
+                            m_SpecificInt(0xff))))
+      continue;
+    if (!Data->getType()->isIntegerTy(8))
+      continue;
+
+    IRBuilder<> Builder(&I);
+    Value *Step = Builder.CreateIntrinsic(Intrinsic::riscv_crc_petar, {},
+                                          {Data, Crc}, nullptr, "crc.step");
+    ORE.emit([&]() {
+      return OptimizationRemark(DEBUG_TYPE, "TableLookupReplaced", &I)
+             << "CRC table lookup in " << ore::NV("Table", Table->getName())
+             << " replaced with a CRC step";
+    });
+    I.replaceAllUsesWith(Step);
+    RecursivelyDeleteTriviallyDeadInstructions(&I);
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+// A loop nest that computes the CRCs of Count messages, Length bytes each:
+//   for (m = 0; m < Count; m++) {
+//     crc = Init;
+//     for (i = 0; i < Length; i++)
+//       crc = crcu8(msgs[m * Stride + i], crc);
+//     crcs[m] = crc;
+//   }
+struct CRCBatchLoop {
+  Loop *Outer;
+  const CRCDescriptor *Desc;
+  const SCEV *Msgs;
+  const SCEV *Stride;
+  unsigned Length;
+  ConstantInt *Init;
+  const SCEV *Crcs;
+  const SCEV *Count;
+};
+
+static bool matchCRCBatchLoop(Loop *P, DominatorTree &DT, ScalarEvolution &SE,
+                              CRCBatchLoop &Batch) {
+  if (P->getSubLoops().size() != 1)
+    return false;
+  Loop *L = P->getSubLoops().front();
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!L->isInnermost() || !L->getLoopPreheader() || !Latch ||
+      L->getExitingBlock() != Latch || !P->getLoopPreheader() ||
+      !P->getUniqueExitBlock() || !P->getLoopLatch() ||
+      P->getExitingBlock() != P->getLoopLatch())
+    return false;
+
+  unsigned Length = SE.getSmallConstantTripCount(L);
+  const SCEV *BackedgeTakenCount = SE.getBackedgeTakenCount(P);
+  if (!Length || Length > CRCBatchMaxLength ||
+      isa<SCEVCouldNotCompute>(BackedgeTakenCount))
+    return false;
+
+  // Check for the running CRC of a message:
+  //   %crc = phi i16 [ Init, %inner.ph ], [ %next, %inner.latch ]
+  //   %next = call i16 @llvm.riscv.crc.petar(i8 %byte, i16 %crc)
+  PHINode *Crc = nullptr;
+  CallInst *Step = nullptr;
+  for (PHINode &Phi : L->getHeader()->phis()) {
+    Value *Next = Phi.getIncomingValueForBlock(Latch);
+    if (!getCRCStepDescriptor(Next) ||
+        cast<CallInst>(Next)->getArgOperand(1) != &Phi)
+      continue;
+    if (Crc)
+      return false;
+    Crc = &Phi;
+    Step = cast<CallInst>(Next);
+  }
+  if (!Crc || !DT.dominates(Step->getParent(), Latch))
+    return false;
+
+  const CRCDescriptor *Desc = getCRCStepDescriptor(Step);
+  auto *Init = dyn_cast<ConstantInt>(Crc->getIncomingValueForBlock(L->getLoopPreheader()));
+  auto *Load = dyn_cast<LoadInst>(Step->getArgOperand(0));
+  if (!Init || !Load || !Load->isSimple() || !L->contains(Load) ||
+      !Load->getType()->isIntegerTy(8) || Desc->DataWidth != 8)
+    return false;
+
+  // Check that the inner loop walks a message byte by byte, and the outer
+  // loop goes from one message to the next: {{Msgs,+,Stride}<P>,+,1}<L>.
+  auto *Byte = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Load->getPointerOperand()));
+  if (!Byte || Byte->getLoop() != L || !Byte->isAffine() ||
+      !Byte->getStepRecurrence(SE)->isOne())
+    return false;
+  auto *Message = dyn_cast<SCEVAddRecExpr>(Byte->getStart());
+  if (!Message || Message->getLoop() != P || !Message->isAffine() ||
+      !SE.isKnownNonNegative(Message->getStepRecurrence(SE)))
+    return false;
+
+  // Check that the CRC of a message is only stored, one element per message,
+  // in the element type the runtime uses for the CRC width.
+  StoreInst *Store = nullptr;
+  for (User *U : Step->users()) {
+    if (U == Crc)
+      continue;
+    Value *Stored = Step;
+    if (auto *Exit = dyn_cast<PHINode>(U))
+      if (!L->contains(Exit) && Exit->getNumIncomingValues() == 1 &&
+          Exit->hasOneUse()) {
+        Stored = Exit;
+        U = Exit->user_back();
+      }
+    auto *SI = dyn_cast<StoreInst>(U);
+    if (Store || !SI || !SI->isSimple() || SI->getValueOperand() != Stored)
+      return false;
+    Store = SI;
+  }
+  if (!Store || L->contains(Store) ||
+      !DT.dominates(Store->getParent(), P->getLoopLatch()))
+    return false;
+
+  unsigned StoreBits = Store->getValueOperand()->getType()->getIntegerBitWidth();
+  auto *Result = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Store->getPointerOperand()));
+  if (StoreBits != std::max(8u, unsigned(PowerOf2Ceil(Desc->Width))) ||
+      !Result || Result->getLoop() != P || !Result->isAffine())
+    return false;
+  auto *ResultStride = dyn_cast<SCEVConstant>(Result->getStepRecurrence(SE));
+  if (!ResultStride || ResultStride->getAPInt() != StoreBits / 8)
+    return false;
+
+  // The runtime reads all messages of a batch before it stores their CRCs,
+  // so the messages and the CRCs have to be in different objects.
+  auto *MsgsBase = dyn_cast<SCEVUnknown>(SE.getPointerBase(Message));
+  auto *CrcsBase = dyn_cast<SCEVUnknown>(SE.getPointerBase(Result));
+  if (!MsgsBase || !CrcsBase)
+    return false;
+  const Value *MsgsObj = getUnderlyingObject(MsgsBase->getValue());
+  const Value *CrcsObj = getUnderlyingObject(CrcsBase->getValue());
+  if (MsgsObj == CrcsObj || !isIdentifiedObject(MsgsObj) ||
+      !isIdentifiedObject(CrcsObj))
+    return false;
+
+  // Check that the loop nest does nothing else that would be lost when it is
+  // deleted.
+  for (BasicBlock *BB : P->blocks()) {
+    for (Instruction &I : *BB) {
+      if (&I != Step && &I != Store && &I != Load &&
+          (I.mayReadOrWriteMemory() || I.mayHaveSideEffects()))
+        return false;
+      for (User *U : I.users())
+        if (!P->contains(cast<Instruction>(U)))
+          return false;
+    }
+  }
+
+  Type *Int64Ty = Type::getInt64Ty(P->getHeader()->getContext());
+  Batch.Outer = P;
+  Batch.Desc = Desc;
+  Batch.Msgs = Message->getStart();
+  Batch.Stride = Message->getStepRecurrence(SE);
+  Batch.Length = Length;
+  Batch.Init = Init;
+  Batch.Crcs = Result->getStart();
+  Batch.Count = SE.getAddExpr(SE.getZeroExtendExpr(BackedgeTakenCount, Int64Ty),
+                              SE.getOne(Int64Ty));
+  return true;
+}
+
+// Replace loop nests that compute the CRCs of many short messages (Modbus
+// frames, sensor packets, headers) with one call of the bit-sliced CRC
+// runtime, which computes up to 256 of them at once:
+//   __crc_bitsliced_batch(&desc, msgs, Stride, Length, Init, crcs, Count)
+// For messages this short the setup of table or clmul based code dominates,
+// while bit-slicing costs the same per byte no matter how short they are.
+static bool lowerCRCBatchLoops(Function &F, LoopInfo &LI, DominatorTree &DT,
+                               ScalarEvolution &SE,
+                               OptimizationRemarkEmitter &ORE) {
+  SmallVector<CRCBatchLoop, 4> Batches;
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    CRCBatchLoop Batch;
+    if (matchCRCBatchLoop(L, DT, SE, Batch))
+      Batches.push_back(Batch);
+  }
+
+  Module &M = *F.getParent();
+  const DataLayout &DL = M.getDataLayout();
+  LLVMContext &Ctx = M.getContext();
+  Type *PtrTy = PointerType::getUnqual(Ctx);
+  Type *SizeTy = DL.getIntPtrType(Ctx);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+
+  for (CRCBatchLoop &Batch : Batches) {
+    Instruction *InsertPt = Batch.Outer->getLoopPreheader()->getTerminator();
+    SCEVExpander Expander(SE, DL, "crc.batch");
+    Value *Msgs = Expander.expandCodeFor(Batch.Msgs, PtrTy, InsertPt);
+    Value *Stride = Expander.expandCodeFor(
+        SE.getTruncateOrZeroExtend(Batch.Stride, SizeTy), SizeTy, InsertPt);
+    Value *Crcs = Expander.expandCodeFor(Batch.Crcs, PtrTy, InsertPt);
+    Value *Count = Expander.expandCodeFor(
+        SE.getTruncateOrZeroExtend(Batch.Count, SizeTy), SizeTy, InsertPt);
+
+    FunctionCallee BatchFn = M.getOrInsertFunction(
+        "__crc_bitsliced_batch", Type::getVoidTy(Ctx), PtrTy, PtrTy, SizeTy,
+        SizeTy, Int64Ty, PtrTy, SizeTy);
+    IRBuilder<> Builder(InsertPt);
+    CallInst *Call = Builder.CreateCall(
+        BatchFn, {getCRCDescriptorGlobal(M, *Batch.Desc), Msgs, Stride,
+                  ConstantInt::get(SizeTy, Batch.Length),
+                  ConstantInt::get(Int64Ty, Batch.Init->getZExtValue()), Crcs,
+                  Count});
+
+    deleteDeadLoop(Batch.Outer, &DT, &SE, &LI);
+    ORE.emit([&]() {
+      return OptimizationRemark(DEBUG_TYPE, "BatchLowered", Call)
+             << "CRC loop over a batch of "
+             << ore::NV("Length", Batch.Length)
+             << " byte messages replaced with the bit-sliced runtime";
+    });
+  }
+
+  return !Batches.empty();
+}
+
+// Check that every byte Load reads in the Count iterations of L was zeroed by
+// a memset that nothing can have overwritten since, e.g. padding or a block
+// that is cleared before it is checksummed:
+//   memset(buf, 0, len);
+//   for (i = 0; i < n; i++)
+//     crc = crcu8(buf[i], crc);
+static bool isZeroedByMemset(LoadInst *Load, Loop *L, const SCEV *Count,
+                             ScalarEvolution &SE, MemorySSA &MSSA) {
+  auto *Ptr = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Load->getPointerOperand()));
+  if (!Ptr || Ptr->getLoop() != L || !Ptr->isAffine() ||
+      !Ptr->getStepRecurrence(SE)->isOne())
+    return false;
+
+  auto *Def = dyn_cast<MemoryDef>(
+      MSSA.getWalker()->getClobberingMemoryAccess(Load));
+  auto *MSI = Def ? dyn_cast_or_null<MemSetInst>(Def->getMemoryInst()) : nullptr;
+  if (!MSI || MSI->isVolatile() || !match(MSI->getValue(), m_Zero()))
+    return false;
+
+  // The bytes [Offset, Offset + Count) the loop reads have to be within the
+  // memset ones.
+  const SCEV *Offset = SE.getMinusSCEV(Ptr->getStart(), SE.getSCEV(MSI->getDest()));
+  if (isa<SCEVCouldNotCompute>(Offset))
+    return false;
+  Type *Int64Ty = Count->getType();
+  Offset = SE.getTruncateOrSignExtend(Offset, Int64Ty);
+  const SCEV *Length = SE.getTruncateOrZeroExtend(SE.getSCEV(MSI->getLength()), Int64Ty);
+  return SE.isKnownNonNegative(Offset) &&
+         SE.isKnownPredicate(ICmpInst::ICMP_ULE, SE.getAddExpr(Offset, Count),
+                             Length);
+}
+
+// A CRC that a loop computes one step per iteration and that is used after
+// the loop:
+//   %crc = phi i16 [ Init, %preheader ], [ %next, %latch ]
+//   %next = call i16 @llvm.riscv.crc.petar(i8 %data, i16 %crc)
+// Count is the number of iterations, as an i64.
+struct CRCLoop {
+  Loop *L;
+  CallInst *Step;
+  const CRCDescriptor *Desc;
+  Value *Init;
+  const SCEV *Count;
+};
+
+static void collectCRCLoops(LoopInfo &LI, DominatorTree &DT,
+                            ScalarEvolution &SE,
+                            SmallVectorImpl<CRCLoop> &CRCLoops) {
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    BasicBlock *Preheader = L->getLoopPreheader();
+    BasicBlock *Latch = L->getLoopLatch();
+    if (!Preheader || !Latch || L->getExitingBlock() != Latch)
+      continue;
+
+    const SCEV *BackedgeTakenCount = SE.getBackedgeTakenCount(L);
+    if (isa<SCEVCouldNotCompute>(BackedgeTakenCount))
+      continue;
+    Type *Int64Ty = Type::getInt64Ty(Preheader->getContext());
+    const SCEV *Count = SE.getAddExpr(
+        SE.getTruncateOrZeroExtend(BackedgeTakenCount, Int64Ty),
+        SE.getOne(Int64Ty));
+
+    for (PHINode &Phi : L->getHeader()->phis()) {
+      Value *Next = Phi.getIncomingValueForBlock(Latch);
+      const CRCDescriptor *Desc = getCRCStepDescriptor(Next);
+      if (!Desc)
+        continue;
+      auto *Step = cast<CallInst>(Next);
+      if (Step->getArgOperand(1) != &Phi ||
+          !DT.dominates(Step->getParent(), Latch) ||
+          none_of(Step->users(), [L](User *U) {
+            return !L->contains(cast<Instruction>(U));
+          }))
+        continue;
+
+      CRCLoops.push_back({L, Step, Desc,
+                          Phi.getIncomingValueForBlock(Preheader), Count});
+    }
+  }
+}
+
+// Forward the CRC computed by the loop to its users outside of the loop. The
+// loop itself is left for loop deletion.
+static void replaceCRCLoopResult(const CRCLoop &CL, Value *Result) {
+  Loop *L = CL.L;
+  CL.Step->replaceUsesWithIf(Result, [L](Use &U) {
+    return !L->contains(cast<Instruction>(U.getUser()));
+  });
+}
+
+// Declare a function of the CRC runtime. The runtime functions only read
+// the descriptor and the data they are given from the memory of the caller;
+// on the first call for a CRC they allocate its context and publish it in
+// the runtime's own cache, which the module cannot access.
+static FunctionCallee getCRCRuntimeFunction(Module &M, StringRef Name,
+                                            FunctionType *FTy) {
+  FunctionCallee Callee = M.getOrInsertFunction(Name, FTy);
+  if (auto *Fn = dyn_cast<Function>(Callee.getCallee())) {
+    Fn->setMemoryEffects(MemoryEffects::argMemOnly(ModRefInfo::Ref) |
+                         MemoryEffects::inaccessibleMemOnly());
+    Fn->setDoesNotThrow();
+    Fn->setWillReturn();
+  }
+  return Callee;
+}
+
+// Update CRCs over runs of zero data in O(log n) instead of byte by byte.
+// Feeding n zero bytes multiplies the register by x^(8n) mod P, so a loop
+// whose data is the constant zero, or a buffer zeroed by memset, computes
+//   crc * x^(8n) mod P
+// which is evaluated at compile time when both crc and n are constants, and
+// with __crc_update_zeros of the CRC runtime otherwise (with -crc-zeros or
+// -crc-lowering=libcall).
+static bool replaceCRCLoopsOverZeros(Function &F, LoopInfo &LI,
+                                     DominatorTree &DT, ScalarEvolution &SE,
+                                     function_ref<MemorySSA &()> GetMSSA,
+                                     OptimizationRemarkEmitter &ORE) {
+  SmallVector<CRCLoop, 4> CRCLoops;
+  collectCRCLoops(LI, DT, SE, CRCLoops);
+  erase_if(CRCLoops, [&](const CRCLoop &CL) {
+    Value *Data = CL.Step->getArgOperand(0);
+    auto *Load = dyn_cast<LoadInst>(Data);
+    return !match(Data, m_Zero()) &&
+           !(Load && Load->isSimple() && CL.L->contains(Load) &&
+             Load->getType()->isIntegerTy(CL.Desc->DataWidth) &&
+             isZeroedByMemset(Load, CL.L, CL.Count, SE, GetMSSA()));
+  });
+
+  bool Changed = false;
+  Module &M = *F.getParent();
+  LLVMContext &Ctx = M.getContext();
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  for (CRCLoop &CL : CRCLoops) {
+    Value *Result = nullptr;
+    auto *Init = dyn_cast<ConstantInt>(CL.Init);
+    auto *Count = dyn_cast<SCEVConstant>(CL.Count);
+    if (Init && Count) {
+      APInt Folded = evaluateCRCOverZeros(
+          *CL.Desc, Count->getAPInt().getZExtValue(), Init->getValue());
+      Result = ConstantInt::get(CL.Step->getType(), Folded);
+    } else if (UseCRCRuntimeForZeros ||
+               CRCLoweringKind == CRCLowering::Libcall) {
+      // Init and the trip count are loop invariant, so the update can go to
+      // the preheader, where it dominates the users of the last step.
+      Instruction *InsertPt = CL.L->getLoopPreheader()->getTerminator();
+      SCEVExpander Expander(SE, M.getDataLayout(), "crc.zeros");
+      Value *Steps = Expander.expandCodeFor(CL.Count, Int64Ty, InsertPt);
+
+      FunctionCallee UpdateZeros = getCRCRuntimeFunction(
+          M, "__crc_update_zeros",
+          FunctionType::get(Int64Ty, {PointerType::getUnqual(Ctx), Int64Ty, Int64Ty},
+                            false));
+      IRBuilder<> Builder(InsertPt);
+      Value *Crc = Builder.CreateZExt(CL.Init, Int64Ty);
+      Value *Call = Builder.CreateCall(
+          UpdateZeros, {getCRCDescriptorGlobal(M, *CL.Desc), Crc, Steps});
+      Result = Builder.CreateTrunc(Call, CL.Step->getType());
+    } else {
+      continue;
+    }
+
+    ORE.emit([&]() {
+      return OptimizationRemark(DEBUG_TYPE, "ZeroRunLowered", CL.Step)
+             << "CRC loop over zero bytes replaced with x^(8n) mod P";
+    });
+    replaceCRCLoopResult(CL, Result);
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+// With -crc-lowering=libcall, replace CRC loops over a buffer
+//   for (i = 0; i < n; i++)
+//     crc = crcu8(buf[i], crc);
+// with one call of the CRC runtime, __crc_update(&desc, crc, buf, n), which
+// picks the fastest kernel (slicing tables, SSE4.2, PCLMUL, VPCLMUL, Zbc or
+// Zvbc) for the CPU it runs on. This is for builds whose target CPU is not
+// known at compile time, e.g. generic x86-64 or rv64gc distribution builds.
+static bool replaceCRCLoopsWithLibcalls(Function &F, LoopInfo &LI,
+                                        DominatorTree &DT, ScalarEvolution &SE,
+                                        OptimizationRemarkEmitter &ORE) {
+  SmallVector<CRCLoop, 4> CRCLoops;
+  collectCRCLoops(LI, DT, SE, CRCLoops);
+  erase_if(CRCLoops, [&](const CRCLoop &CL) {
+    // The whole buffer is read before the loop, so nothing in the loop may
+    // write to memory.
+    for (BasicBlock *BB : CL.L->blocks())
+      for (Instruction &I : *BB)
+        if (&I != CL.Step && I.mayWriteToMemory())
+          return true;
+
+    auto *Load = dyn_cast<LoadInst>(CL.Step->getArgOperand(0));
+    if (!Load || !Load->isSimple() || !CL.L->contains(Load) ||
+        !Load->getType()->isIntegerTy(8) || CL.Desc->DataWidth != 8)
+      return true;
+    auto *Ptr = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Load->getPointerOperand()));
+    return !Ptr || Ptr->getLoop() != CL.L || !Ptr->isAffine() ||
+           !Ptr->getStepRecurrence(SE)->isOne();
+  });
+
+  Module &M = *F.getParent();
+  LLVMContext &Ctx = M.getContext();
+  Type *PtrTy = PointerType::getUnqual(Ctx);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  Type *SizeTy = M.getDataLayout().getIntPtrType(Ctx);
+  for (CRCLoop &CL : CRCLoops) {
+    auto *Load = cast<LoadInst>(CL.Step->getArgOperand(0));
+    auto *Ptr = cast<SCEVAddRecExpr>(SE.getSCEV(Load->getPointerOperand()));
+    Instruction *InsertPt = CL.L->getLoopPreheader()->getTerminator();
+    SCEVExpander Expander(SE, M.getDataLayout(), "crc.buffer");
+    Value *Buffer = Expander.expandCodeFor(Ptr->getStart(), PtrTy, InsertPt);
+    Value *Length = Expander.expandCodeFor(
+        SE.getTruncateOrZeroExtend(CL.Count, SizeTy), SizeTy, InsertPt);
+
+    FunctionCallee Update = getCRCRuntimeFunction(
+        M, "__crc_update",
+        FunctionType::get(Int64Ty, {PtrTy, Int64Ty, PtrTy, SizeTy}, false));
+    IRBuilder<> Builder(InsertPt);
+    Value *Crc = Builder.CreateZExt(CL.Init, Int64Ty);
+    CallInst *Call = Builder.CreateCall(
+        Update, {getCRCDescriptorGlobal(M, *CL.Desc), Crc, Buffer, Length});
+    replaceCRCLoopResult(CL, Builder.CreateTrunc(Call, CL.Step->getType()));
+    ORE.emit([&]() {
+      return OptimizationRemark(DEBUG_TYPE, "BufferLoopLowered", Call)
+             << "CRC loop over a buffer replaced with a call of the CRC runtime";
+    });
+  }
+
+  return !CRCLoops.empty();
+}
+
+// If V is one byte of a wider value, trunc(Src) or trunc(lshr(Src, 8 * Index)),
+// return Src and set Index, otherwise return nullptr.
+static Value *matchByteOfValue(Value *V, unsigned &Index) {
+  Value *Src;
+  const APInt *Shift = nullptr;
+  if (!match(V, m_Trunc(m_LShr(m_Value(Src), m_APInt(Shift)))) &&
+      !match(V, m_Trunc(m_Value(Src))))
+    return nullptr;
+  if (!V->getType()->isIntegerTy(8) || !Src->getType()->isIntegerTy())
+    return nullptr;
+
+  Index = 0;
+  if (Shift) {
+    if (Shift->urem(8) ||
+        Shift->uge(Src->getType()->getIntegerBitWidth()))
+      return nullptr;
+    Index = Shift->getZExtValue() / 8;
+  }
+  return Src;
+}
+
+// Fuse chains of CRC steps over consecutive bytes of one value, least
+// significant byte first, into one step over all of them:
+//   %c1 = call i16 @crcu8(i8 trunc(%v), i16 %c0)
+//   %c2 = call i16 @crcu8(i8 trunc(lshr(%v, 8)), i16 %c1)
+// becomes
+//   %crc.wide = call i16 @llvm.riscv.crc.petar.wide.i16(i16 trunc(%v), i16 %c0)
+// which is what crcu16 and crcu32 of CoreMark look like once crcu8 has been
+// recognized and inlined. Four steps become one 32 bit step, two or three
+// steps one 16 bit step (the third one is left as it is). Only the last step
+// of a chain may be used outside of it.
+static bool fuseCRCStepChains(Function &F, OptimizationRemarkEmitter &ORE) {
+  const CRCDescriptor *CRCU8 = &getCRCU8Descriptor();
+  auto isByteStep = [&](const Value *V) {
+    return getCRCStepDescriptor(V) == CRCU8;
+  };
+
+  // The chains are collected first, every step belongs to at most one.
+  SmallVector<SmallVector<CallInst *, 4>, 4> Chains;
+  SmallPtrSet<CallInst *, 16> Fused;
+  for (Instruction &I : instructions(F)) {
+    auto *First = dyn_cast<CallInst>(&I);
+    unsigned FirstIndex;
+    if (!First || Fused.count(First) || !isByteStep(First))
+      continue;
+    Value *Src = matchByteOfValue(First->getArgOperand(0), FirstIndex);
+    if (!Src)
+      continue;
+
+    SmallVector<CallInst *, 4> Chain = {First};
+    while (Chain.size() < 4 && Chain.back()->hasOneUse()) {
+      auto *Next = dyn_cast<CallInst>(Chain.back()->user_back());
+      unsigned Index;
+      if (!Next || Next->getParent() != First->getParent() ||
+          !isByteStep(Next) || Next->getArgOperand(1) != Chain.back() ||
+          matchByteOfValue(Next->getArgOperand(0), Index) != Src ||
+          Index != FirstIndex + Chain.size())
+        break;
+      Chain.push_back(Next);
+    }
+    if (Chain.size() < 2)
+      continue;
+    Chain.resize(Chain.size() == 4 ? 4 : 2);
+    Fused.insert(Chain.begin(), Chain.end());
+    Chains.push_back(std::move(Chain));
+  }
+
+  for (const SmallVector<CallInst *, 4> &Chain : Chains) {
+    CallInst *Last = Chain.back();
+    unsigned Index;
+    Value *Src = matchByteOfValue(Chain.front()->getArgOperand(0), Index);
+
+    IRBuilder<> Builder(Last);
+    Value *Data = Src;
+    if (Index)
+      Data = Builder.CreateLShr(Data, 8 * Index);
+    Data = Builder.CreateZExtOrTrunc(Data, Builder.getIntNTy(8 * Chain.size()));
+    Value *Step = Builder.CreateIntrinsic(
+        Intrinsic::riscv_crc_petar_wide, {Data->getType()},
+        {Data, Chain.front()->getArgOperand(1)}, nullptr, "crc.wide");
+    ORE.emit([&]() {
+      return OptimizationRemark(DEBUG_TYPE, "StepsFused", Last)
+             << ore::NV("Steps", unsigned(Chain.size())) << " CRC steps in "
+             << ore::NV("Function", F.getName()) << " fused into one step";
+    });
+    Last->replaceAllUsesWith(Step);
+    for (CallInst *CI : reverse(Chain))
+      CI->eraseFromParent();
+  }
+
+  return !Chains.empty();
+}
+
+// Vectorization factors of the vector variants of recognized CRC functions.
+static const unsigned CRCVectorFactors[] = {4, 8, 16};
+
+// Return the VF lane vector variant of the CRC function ScalarF, creating it
+// the first time it is needed:
+//   define linkonce_odr hidden <4 x i16> @__crcu8_v4(<4 x i8> %0, <4 x i16> %1) {
+//     %3 = call <4 x i16> @llvm.riscv.crc.petar.vector.v4i16(<4 x i8> %0, <4 x i16> %1)
+//     ret <4 x i16> %3
+//   }
+// The variant has to survive until LoopVectorize looks for it, so it is kept
+// alive through llvm.compiler.used, like the declarations InjectTLIMappings
+// adds for vector library functions.
+static Function *getOrCreateCRCVectorVariant(Function &ScalarF, unsigned VF) {
+  Module &M = *ScalarF.getParent();
+  std::string Name = ("__" + ScalarF.getName() + "_v" + Twine(VF)).str();
+  if (Function *VecF = M.getFunction(Name))
+    return VecF;
+
+  LLVMContext &Ctx = M.getContext();
+  auto *DataTy = FixedVectorType::get(ScalarF.getArg(0)->getType(), VF);
+  auto *CrcTy = FixedVectorType::get(ScalarF.getReturnType(), VF);
+  FunctionType *FTy = FunctionType::get(CrcTy, {DataTy, CrcTy}, false);
+  Function *VecF =
+      Function::Create(FTy, GlobalValue::LinkOnceODRLinkage, Name, M);
+  VecF->setVisibility(GlobalValue::HiddenVisibility);
+  VecF->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+  VecF->setDoesNotAccessMemory();
+  VecF->setDoesNotThrow();
+  VecF->setWillReturn();
+
+  IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", VecF));
+  Value *Step = Builder.CreateIntrinsic(Intrinsic::riscv_crc_petar_vector,
+                                        {CrcTy},
+                                        {VecF->getArg(0), VecF->getArg(1)});
+  Builder.CreateRet(Step);
+
+  appendToCompilerUsed(M, {VecF});
+  return VecF;
+}
+
+// Mark F as a CRC step wrapper, see CRCStepWrapperAttr, and as not touching
+// memory if it only wraps a CRC step (crcu8 after it has been recognized):
+// its stores only go to its own parameter slots. This is done from the run
+// on F itself, the calls of F are marked by addCRCVectorVariants in
+// crc-vector-variants.
+static bool markCRCStepWrapper(Function &F) {
+  if (F.hasFnAttribute(CRCStepWrapperAttr) || !getCRCStepWrapperDescriptor(F))
+    return false;
+  F.addFnAttr(CRCStepWrapperAttr);
+  F.setDoesNotAccessMemory();
+  F.setDoesNotThrow();
+  F.setWillReturn();
+  return true;
+}
+
+// Let LoopVectorize run independent CRC computations side by side, e.g. one
+// CRC per packet or per row:
+//   for (i = 0; i < n; i++)
+//     crc[i] = crcu8(data[i], crc[i]);
+// Calls of recognized CRC functions get vector variants in the
+// vector-function-abi-variant attribute, which the vectorizer maps the call
+// to through VFDatabase. Only the vectorization factors whose CRC vector fits
+// in the target's vector registers are offered, so targets without vector
+// support keep the scalar calls. The variants are definitions of their own,
+// so this is done by CRCVectorVariantsPass, not by the run on F.
+static bool
+addCRCVectorVariants(Function &F,
+                     function_ref<const TargetTransformInfo &()> GetTTI) {
+  std::optional<uint64_t> RegisterBits;
+  bool Changed = false;
+
+  for (Instruction &I : instructions(F)) {
+    // Only calls of wrappers, the intrinsic itself has no vector variants.
+    auto *CI = dyn_cast<CallInst>(&I);
+    if (!CI || CI->getIntrinsicID() == Intrinsic::riscv_crc_petar)
+      continue;
+    const CRCDescriptor *Desc = getCRCStepDescriptor(CI);
+    if (!Desc)
+      continue;
+    Function *Callee = CI->getCalledFunction();
+
+    SmallVector<std::string, 8> Mappings;
+    VFABI::getVectorVariantNames(*CI, Mappings);
+    if (!Mappings.empty())
+      continue;
+
+    if (!RegisterBits)
+      RegisterBits =
+          GetTTI()
+              .getRegisterBitWidth(TargetTransformInfo::RGK_FixedWidthVector)
+              .getFixedValue();
+    for (unsigned VF : CRCVectorFactors) {
+      if (VF * Desc->Width > *RegisterBits)
+        continue;
+      Function *VecF = getOrCreateCRCVectorVariant(*Callee, VF);
+      Mappings.push_back(("_ZGV_LLVM_N" + Twine(VF) + "vv_" +
+                          Callee->getName() + "(" + VecF->getName() + ")")
+                             .str());
+    }
+    if (Mappings.empty())
+      continue;
+
+    // Calls are only vectorized when they do not touch memory. That holds for
+    // the wrapper, see markCRCStepWrapper, and the call is marked the same.
+    CI->setDoesNotAccessMemory();
+    CI->setDoesNotThrow();
+    CI->addFnAttr(Attribute::WillReturn);
+    VFABI::setVectorVariantNames(CI, Mappings);
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+// A loop the lowerings left behind for loop deletion: it terminates, nothing
+// in it has side effects (calls of crcu8 wrappers only write their own
+// parameter slots) and nothing outside of it uses its values.
+static bool isDeadLoop(const Loop &L, ScalarEvolution &SE) {
+  if (!SE.hasLoopInvariantBackedgeTakenCount(&L))
+    return false;
+  for (BasicBlock *BB : L.blocks())
+    for (Instruction &I : *BB) {
+      if (I.mayHaveSideEffects() && !getCRCStepDescriptor(&I))
+        return false;
+      for (User *U : I.users())
+        if (!L.contains(cast<Instruction>(U)))
+          return false;
+    }
+  return true;
+}
+
+// Static estimate of the cost of one call of F on the target: the reciprocal
+// throughput TTI gives every live instruction, times the constant trip counts
+// of the loops around it. Loops whose trip count is not a constant count
+// once, so the estimate of a loop over a buffer is the cost of one iteration.
+static int64_t estimateCostPerCall(Function &F, const TargetTransformInfo &TTI,
+                                   LoopInfo &LI, ScalarEvolution &SE) {
+  SmallPtrSet<const Loop *, 8> DeadLoops;
+  for (Loop *L : LI.getLoopsInPreorder())
+    if (isDeadLoop(*L, SE))
+      DeadLoops.insert(L);
+
+  InstructionCost Cost = 0;
+  for (BasicBlock &BB : F) {
+    int64_t TripCount = 1;
+    bool Dead = false;
+    for (Loop *L = LI.getLoopFor(&BB); L && !Dead; L = L->getParentLoop()) {
+      Dead = DeadLoops.count(L);
+      if (unsigned LoopTripCount = SE.getSmallConstantTripCount(L))
+        TripCount *= LoopTripCount;
+    }
+    if (Dead)
+      continue;
+    for (Instruction &I : BB)
+      if (!isInstructionTriviallyDead(&I))
+        Cost += TTI.getInstructionCost(&I, TargetTransformInfo::TCK_RecipThroughput) *
+                TripCount;
+  }
+  return Cost.isValid() ? *Cost.getValue() : -1;
+}
+
+// Return true if F computes a CRC step anywhere; the loop level transforms
+// only look at loops around CRC steps.
+static bool hasCRCSteps(Function &F) {
+  return any_of(instructions(F), [](const Instruction &I) {
+    return getCRCStepDescriptor(&I) != nullptr;
+  });
+}
+
 PreservedAnalyses RecognizingCRCPass::run(Function &F, FunctionAnalysisManager &AM) {
+  bool Changed = false;
+
+  // Most functions compute no CRC at all, so the analyses are only built once
+  // a transform needs them.
+  auto &ORE = AM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+  auto GetTTI = [&]() -> TargetTransformInfo & {
+    return AM.getResult<TargetIRAnalysis>(F);
+  };
+  // The cost estimates are only computed when someone asked for the remarks.
+  bool EmitCostRemarks =
+      F.getContext().getDiagHandlerPtr()->isPassedOptRemarkEnabled(DEBUG_TYPE);
+  int64_t OriginalCost =
+      EmitCostRemarks
+          ? estimateCostPerCall(F, GetTTI(), AM.getResult<LoopAnalysis>(F),
+                                AM.getResult<ScalarEvolutionAnalysis>(F))
+          : 0;
+
+  // Table lookups become CRC steps first, so that they are folded and lowered
+  // like every other step (unless steps are being lowered to lookups). Only
+  // the RISC-V backend selects the steps that are left over.
+  if (CRCLoweringKind != CRCLowering::Table &&
+      (ReplaceCRCTableLookups ||
+       Triple(F.getParent()->getTargetTriple()).isRISCV()))
+    Changed |= replaceTableLookupsWithCRCSteps(F, ORE);
+  Changed |= foldConstantCRCCalls(F, [&]() -> AAResults & {
+    return AM.getResult<AAManager>(F);
+  });
+  if (hasCRCSteps(F)) {
+    auto &LI = AM.getResult<LoopAnalysis>(F);
+    auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+    auto &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+    Changed |= foldCRCLoopsOverConstantBuffers(LI, DT, SE, ORE);
+    if (UseBitslicedCRCBatches)
+      Changed |= lowerCRCBatchLoops(F, LI, DT, SE, ORE);
+    Changed |= replaceCRCLoopsOverZeros(F, LI, DT, SE, [&]() -> MemorySSA & {
+      return AM.getResult<MemorySSAAnalysis>(F).getMSSA();
+    }, ORE);
+    if (CRCLoweringKind == CRCLowering::Libcall)
+      Changed |= replaceCRCLoopsWithLibcalls(F, LI, DT, SE, ORE);
+  }
+  // Wide steps are only selected by the RISC-V backend, the other lowerings
+  // keep the byte steps.
+  if (CRCLoweringKind == CRCLowering::Intrinsic && FuseCRCSteps)
+    Changed |= fuseCRCStepChains(F, ORE);
+  if (CRCLoweringKind == CRCLowering::Table)
+    Changed |= lowerCRCStepsToTableLookups(F);
+
   if (UseNaiveCRCOptimization && !UseIntrinsicsCRCOptimization) {
     errs() << "The IR level CRC optimization is about to be run...\n";
     bool crc_flag = tryToRecognizeCRC32_v1(F.back().back());
@@ -800,6 +1972,7 @@ PreservedAnalyses RecognizingCRCPass::run(Function &F, FunctionAnalysisManager &
     if (crc_flag) {
       errs() << "The IR level CRC optimization has been successfully applied!" << "\n";
     }  
+    Changed |= crc_flag;
   } else if (!UseNaiveCRCOptimization && UseIntrinsicsCRCOptimization) {
     errs() << "The CRC optimization with intrinsic function is about to be run...\n";
     bool crc_flag = tryToRecognizeCRC32_v2(F.back().back());
@@ -807,9 +1980,459 @@ PreservedAnalyses RecognizingCRCPass::run(Function &F, FunctionAnalysisManager &
     if (crc_flag) {
       errs() << "The CRC optimization with intrinsic function has been successfully applied!" << "\n";
     }
+    Changed |= crc_flag;
   } else if (UseNaiveCRCOptimization && UseIntrinsicsCRCOptimization) {
     errs() << "Wrong usage! Choose one optimization approach only!\n";
   }
 
-  return PreservedAnalyses::all();
+  Changed |= markCRCStepWrapper(F);
+
+  if (Changed && EmitCostRemarks) {
+    // The loops may be gone, so the analyses of the rewritten body are built
+    // from scratch; the cached ones are invalidated when the pass returns.
+    DominatorTree NewDT(F);
+    LoopInfo NewLI(NewDT);
+    ScalarEvolution NewSE(F, AM.getResult<TargetLibraryAnalysis>(F),
+                          AM.getResult<AssumptionAnalysis>(F), NewDT, NewLI);
+    int64_t NewCost = estimateCostPerCall(F, GetTTI(), NewLI, NewSE);
+    ORE.emit([&]() {
+      return OptimizationRemark(DEBUG_TYPE, "CRCCost", &F)
+             << "CRC in " << ore::NV("Function", F.getName())
+             << " lowered, estimated cost per call "
+             << ore::NV("OriginalCost", OriginalCost) << " -> "
+             << ore::NV("NewCost", NewCost);
+    });
+  }
+
+  return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
+
+PreservedAnalyses CRCVectorVariantsPass::run(Module &M,
+                                             ModuleAnalysisManager &AM) {
+  // The variants are made of llvm.riscv.crc.petar.vector, which only the
+  // RISC-V backend selects.
+  if (!Triple(M.getTargetTriple()).isRISCV())
+    return PreservedAnalyses::all();
+
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  bool Changed = false;
+
+  // The variants are added to M while it is walked; they call no wrappers.
+  for (Function &F : make_early_inc_range(M)) {
+    if (F.isDeclaration())
+      continue;
+    Changed |= addCRCVectorVariants(F, [&]() -> const TargetTransformInfo & {
+      return FAM.getResult<TargetIRAnalysis>(F);
+    });
+  }
+
+  return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
+
+PreservedAnalyses CRCTableMergePass::run(Module &M, ModuleAnalysisManager &AM) {
+  bool Changed = false;
+
+  for (GlobalVariable &GV : make_early_inc_range(M.globals())) {
+    if (!GV.isConstant() || !GV.hasDefinitiveInitializer() ||
+        !GV.hasLocalLinkage() || GV.isThreadLocal())
+      continue;
+
+    auto *Entries = dyn_cast<ConstantDataArray>(GV.getInitializer());
+    if (!Entries)
+      continue;
+    std::optional<CRCDescriptor> Desc = matchCRCTable(*Entries);
+    if (!Desc)
+      continue;
+
+    // Tables whose lookups have all been recognized as CRC steps are dead.
+    GV.removeDeadConstantUsers();
+    if (GV.use_empty()) {
+      LLVM_DEBUG(dbgs() << "Unused CRC table " << GV.getName() << " deleted\n");
+      GV.eraseFromParent();
+      Changed = true;
+      continue;
+    }
+
+    // Only tables whose address is never compared can be replaced by another
+    // copy.
+    if (!GV.hasGlobalUnnamedAddr())
+      continue;
+
+    auto *EltTy = cast<IntegerType>(Entries->getElementType());
+    GlobalVariable *Canonical = getCRCTableGlobal(M, *Desc, EltTy);
+    LLVM_DEBUG(dbgs() << "CRC table " << GV.getName() << " merged into "
+                      << Canonical->getName() << "\n");
+    GV.replaceAllUsesWith(Canonical);
+    GV.eraseFromParent();
+    Changed = true;
+  }
+
+  return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
+
+// Contents of the globals a table initialization function reads or writes,
+// one constant per element (a scalar global has a single element).
+using CRCTableInitState = MapVector<GlobalVariable *, SmallVector<Constant *, 0>>;
+
+// Return the element of State that Ptr points to, if Ptr is a constant
+// pointer to a whole element of Ty of a global F may access, otherwise return
+// nullptr. Constant globals are read from their initializers, the globals F
+// writes are added to State on first access.
+static Constant **getTableInitSlot(CRCTableInitState &State, Constant *Ptr,
+                                   Type *Ty, const DataLayout &DL) {
+  APInt Offset(DL.getIndexTypeSizeInBits(Ptr->getType()), 0);
+  auto *GV = dyn_cast<GlobalVariable>(
+      Ptr->stripAndAccumulateConstantOffsets(DL, Offset,
+                                             /*AllowNonInbounds=*/true));
+  if (!GV || !GV->hasDefinitiveInitializer() || GV->isThreadLocal() ||
+      (!GV->isConstant() && !GV->hasLocalLinkage()))
+    return nullptr;
+
+  Type *EltTy = GV->getValueType();
+  uint64_t NumElements = 1;
+  if (auto *ArrTy = dyn_cast<ArrayType>(EltTy)) {
+    EltTy = ArrTy->getElementType();
+    NumElements = ArrTy->getNumElements();
+  }
+  uint64_t EltSize = DL.getTypeAllocSize(EltTy);
+  if (EltTy != Ty || !EltTy->isIntegerTy() || Offset.isNegative() ||
+      Offset.urem(EltSize) != 0 || Offset.udiv(EltSize).uge(NumElements))
+    return nullptr;
+
+  auto [It, Inserted] = State.insert({GV, {}});
+  if (Inserted)
+    for (uint64_t I = 0; I < NumElements; ++I)
+      It->second.push_back(NumElements == 1
+                               ? GV->getInitializer()
+                               : GV->getInitializer()->getAggregateElement(I));
+  return &It->second[Offset.udiv(EltSize).getZExtValue()];
+}
+
+// Run F, which takes no arguments and returns nothing, on the globals in
+// State in a small interpreter and leave their contents after the call in
+// State. Only integer arithmetic, branches, and loads and stores of whole
+// elements of globals are supported, and F has to be in SSA form (after
+// mem2reg), which is what the loops that fill CRC tables at startup look
+// like, e.g. zlib's make_crc_table:
+//   for (n = 0; n < 256; n++) {
+//     c = n;
+//     for (k = 0; k < 8; k++)
+//       c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+//     crc_table[n] = c;
+//   }
+// Returns false when F does anything else or runs for more than
+// -crc-table-init-budget instructions.
+static bool evaluateTableInit(Function &F, CRCTableInitState &State,
+                              const DataLayout &DL,
+                              const TargetLibraryInfo *TLI) {
+  DenseMap<Value *, Constant *> Values;
+  auto GetValue = [&](Value *V) -> Constant * {
+    if (auto *C = dyn_cast<Constant>(V))
+      return C;
+    return Values.lookup(V);
+  };
+
+  unsigned Budget = CRCTableInitBudget;
+  BasicBlock *Pred = nullptr;
+  for (BasicBlock *BB = &F.getEntryBlock(); BB;) {
+    // The phis of a block take their values at the same time.
+    SmallVector<std::pair<PHINode *, Constant *>, 8> Incoming;
+    for (PHINode &Phi : BB->phis()) {
+      Constant *C = Pred ? GetValue(Phi.getIncomingValueForBlock(Pred)) : nullptr;
+      if (!C)
+        return false;
+      Incoming.push_back({&Phi, C});
+    }
+    for (auto &[Phi, C] : Incoming)
+      Values[Phi] = C;
+
+    BasicBlock *Next = nullptr;
+    for (Instruction &I : make_range(BB->getFirstNonPHI()->getIterator(),
+                                     BB->end())) {
+      if (!Budget--)
+        return false;
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+
+      if (auto *RI = dyn_cast<ReturnInst>(&I))
+        return !RI->getReturnValue();
+
+      if (auto *BI = dyn_cast<BranchInst>(&I)) {
+        if (BI->isUnconditional()) {
+          Next = BI->getSuccessor(0);
+          break;
+        }
+        auto *Cond = dyn_cast_or_null<ConstantInt>(GetValue(BI->getCondition()));
+        if (!Cond)
+          return false;
+        Next = BI->getSuccessor(Cond->isZero());
+        break;
+      }
+
+      if (auto *Load = dyn_cast<LoadInst>(&I)) {
+        Constant *Ptr = GetValue(Load->getPointerOperand());
+        Constant **Slot = Ptr && Load->isSimple()
+                              ? getTableInitSlot(State, Ptr, Load->getType(), DL)
+                              : nullptr;
+        if (!Slot)
+          return false;
+        Values[Load] = *Slot;
+        continue;
+      }
+
+      if (auto *Store = dyn_cast<StoreInst>(&I)) {
+        Constant *Ptr = GetValue(Store->getPointerOperand());
+        Constant *Val = GetValue(Store->getValueOperand());
+        Constant **Slot = Ptr && Val && Store->isSimple()
+                              ? getTableInitSlot(State, Ptr, Val->getType(), DL)
+                              : nullptr;
+        if (!Slot || cast<GlobalVariable>(getUnderlyingObject(Ptr))->isConstant())
+          return false;
+        *Slot = Val;
+        continue;
+      }
+
+      if (I.mayReadOrWriteMemory() || I.isTerminator())
+        return false;
+
+      SmallVector<Constant *, 4> Ops;
+      for (Value *Op : I.operands()) {
+        Ops.push_back(GetValue(Op));
+        if (!Ops.back())
+          return false;
+      }
+      Constant *C;
+      if (auto *Cmp = dyn_cast<CmpInst>(&I))
+        C = ConstantFoldCompareInstOperands(Cmp->getPredicate(), Ops[0], Ops[1],
+                                            DL, TLI);
+      else
+        C = ConstantFoldInstOperands(&I, Ops, DL, TLI);
+      if (!C)
+        return false;
+      Values[&I] = C;
+    }
+
+    Pred = BB;
+    BB = Next;
+  }
+
+  return false;
+}
+
+// Collect the loads of GV and check that it is only ever written by F.
+static bool collectTableInitLoads(Value *Ptr, Function &F,
+                                  SmallVectorImpl<LoadInst *> &Loads) {
+  for (User *U : Ptr->users()) {
+    if (auto *Load = dyn_cast<LoadInst>(U)) {
+      Loads.push_back(Load);
+      continue;
+    }
+    if (auto *Store = dyn_cast<StoreInst>(U))
+      if (Store->getPointerOperand() == Ptr && Store->getFunction() == &F)
+        continue;
+    if (isa<GEPOperator>(U) || isa<BitCastOperator>(U)) {
+      if (!collectTableInitLoads(U, F, Loads))
+        return false;
+      continue;
+    }
+    return false;
+  }
+  return true;
+}
+
+// Return the block of the lazy initialization guard Load belongs to:
+//   if (!table_ready)
+//     make_crc_table();
+// i.e. the branch on Load goes to a block that calls F when Load reads the
+// initial value of the flag and the other way once F has run.
+static BasicBlock *getTableInitGuard(LoadInst *Load, Function &F,
+                                     Constant *Initial, Constant *Final,
+                                     const DataLayout &DL) {
+  auto *BI = dyn_cast<BranchInst>(Load->getParent()->getTerminator());
+  if (!BI || BI->isUnconditional())
+    return nullptr;
+
+  // Evaluate the condition for both values of the flag.
+  auto Fold = [&](Constant *Flag) -> ConstantInt * {
+    DenseMap<Value *, Constant *> Values{{Load, Flag}};
+    for (Instruction &I : make_range(std::next(Load->getIterator()),
+                                     BI->getIterator())) {
+      SmallVector<Constant *, 2> Ops;
+      for (Value *Op : I.operands())
+        Ops.push_back(isa<Constant>(Op) ? cast<Constant>(Op) : Values.lookup(Op));
+      if (is_contained(Ops, nullptr) || I.mayHaveSideEffects())
+        continue;
+      if (auto *Cmp = dyn_cast<CmpInst>(&I))
+        Values[&I] = ConstantFoldCompareInstOperands(Cmp->getPredicate(),
+                                                     Ops[0], Ops[1], DL);
+      else
+        Values[&I] = ConstantFoldInstOperands(&I, Ops, DL);
+    }
+    return dyn_cast_or_null<ConstantInt>(Values.lookup(BI->getCondition()));
+  };
+  ConstantInt *Before = Fold(Initial);
+  ConstantInt *After = Fold(Final);
+  if (!Before || !After || Before == After)
+    return nullptr;
+
+  BasicBlock *Uninitialized = BI->getSuccessor(Before->isZero());
+  if (Uninitialized->getSinglePredecessor() != BI->getParent() ||
+      none_of(*Uninitialized, [&F](Instruction &I) {
+        auto *CI = dyn_cast<CallInst>(&I);
+        return CI && CI->getCalledFunction() == &F;
+      }))
+    return nullptr;
+  return BI->getParent();
+}
+
+PreservedAnalyses CRCTableInitPass::run(Module &M, ModuleAnalysisManager &AM) {
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  const DataLayout &DL = M.getDataLayout();
+  bool Changed = false;
+
+  for (Function &F : make_early_inc_range(M)) {
+    if (F.isDeclaration() || !F.arg_empty() || !F.getReturnType()->isVoidTy())
+      continue;
+
+    // F has to be called directly, and only for its effect on globals.
+    SmallVector<CallInst *, 4> Calls;
+    if (any_of(F.users(), [&](User *U) {
+          auto *CI = dyn_cast<CallInst>(U);
+          if (!CI || CI->getCalledOperand() != &F)
+            return true;
+          Calls.push_back(CI);
+          return false;
+        }))
+      continue;
+
+    CRCTableInitState Final;
+    auto &TLI = FAM.getResult<TargetLibraryAnalysis>(F);
+    if (!evaluateTableInit(F, Final, DL, &TLI))
+      continue;
+    CRCTableInitState Initial = Final;
+    for (auto &[GV, Elements] : Initial)
+      for (unsigned I = 0; I < Elements.size(); ++I)
+        Elements[I] = Elements.size() == 1
+                          ? GV->getInitializer()
+                          : GV->getInitializer()->getAggregateElement(I);
+
+    // A second call must not change anything, so that F can be treated as
+    // having run before the program starts.
+    CRCTableInitState Again = Final;
+    if (!evaluateTableInit(F, Again, DL, &TLI) ||
+        any_of(Again, [&](auto &Entry) {
+          return Entry.second != Final[Entry.first];
+        }))
+      continue;
+
+    // Only replace initializations that fill a CRC table.
+    auto GetInitializer = [](GlobalVariable *GV, ArrayRef<Constant *> Elements) {
+      if (auto *ArrTy = dyn_cast<ArrayType>(GV->getValueType()))
+        return ConstantArray::get(ArrTy, Elements);
+      return Elements.front();
+    };
+    bool FillsCRCTable = any_of(Final, [&](auto &Entry) {
+      auto *Table = dyn_cast<ConstantDataArray>(
+          GetInitializer(Entry.first, Entry.second));
+      return !Entry.first->isConstant() && Table && matchCRCTable(*Table);
+    });
+    if (!FillsCRCTable)
+      continue;
+
+    // Every read of the written globals outside of F has to happen after F
+    // has run: after a call of F, or after a lazy initialization guard on
+    // one of them, which calls F unless it already ran.
+    DenseMap<Function *, SmallVector<std::pair<Instruction *, BasicBlock *>, 2>>
+        RunPoints;
+    for (CallInst *CI : Calls)
+      RunPoints[CI->getFunction()].push_back({CI, nullptr});
+    bool OnlyReadAfterInit = true;
+    SmallVector<LoadInst *, 16> Loads;
+    for (auto &[GV, Elements] : Final) {
+      SmallVector<LoadInst *, 8> GVLoads;
+      if (GV->isConstant())
+        continue;
+      if (!collectTableInitLoads(GV, F, GVLoads)) {
+        OnlyReadAfterInit = false;
+        break;
+      }
+      for (LoadInst *Load : GVLoads) {
+        if (Load->getFunction() == &F)
+          continue;
+        Loads.push_back(Load);
+        if (Elements.size() != 1)
+          continue;
+        if (BasicBlock *Guard = getTableInitGuard(Load, F, Initial[GV].front(),
+                                                  Elements.front(), DL))
+          RunPoints[Load->getFunction()].push_back({Load, Guard});
+      }
+    }
+    for (LoadInst *Load : Loads) {
+      Function *Reader = Load->getFunction();
+      auto &DT = FAM.getResult<DominatorTreeAnalysis>(*Reader);
+      OnlyReadAfterInit &= any_of(RunPoints[Reader], [&](auto &RunPoint) {
+        auto [I, Guard] = RunPoint;
+        return I == Load || (Guard ? DT.dominates(Guard, Load->getParent()) &&
+                                         Load->getParent() != Guard
+                                   : DT.dominates(I, Load));
+      });
+    }
+    if (!OnlyReadAfterInit)
+      continue;
+
+    // Start the program with the contents F leaves behind. Calling F again
+    // changes nothing, so the calls go away, and with them the lazy
+    // initialization branches once the guard flag is constant.
+    for (auto &[GV, Elements] : Final)
+      if (!GV->isConstant())
+        GV->setInitializer(GetInitializer(GV, Elements));
+    for (CallInst *CI : Calls)
+      CI->eraseFromParent();
+    OptimizationRemarkEmitter ORE(&F);
+    ORE.emit([&]() {
+      return OptimizationRemark(DEBUG_TYPE, "TableInitEvaluated", &F)
+             << "CRC table initialization " << ore::NV("Function", F.getName())
+             << " evaluated at compile time";
+    });
+    Changed = true;
+    if (!F.hasLocalLinkage())
+      continue;
+
+    // Nothing writes the globals any more.
+    FAM.clear(F, F.getName());
+    F.eraseFromParent();
+    SmallPtrSet<BasicBlock *, 8> Guards;
+    for (auto &[GV, Elements] : Final) {
+      if (GV->isConstant())
+        continue;
+      GV->setConstant(true);
+      for (LoadInst *Load : Loads) {
+        if (getUnderlyingObject(Load->getPointerOperand()) != GV ||
+            Elements.size() != 1)
+          continue;
+        Guards.insert(Load->getParent());
+        Load->replaceAllUsesWith(Elements.front());
+        Load->eraseFromParent();
+      }
+    }
+    for (BasicBlock *BB : Guards) {
+      for (Instruction &I : make_early_inc_range(*BB))
+        if (Constant *C = ConstantFoldInstruction(&I, DL)) {
+          I.replaceAllUsesWith(C);
+          I.eraseFromParent();
+        }
+      ConstantFoldTerminator(BB, /*DeleteDeadConditions=*/true);
+    }
+    SmallPtrSet<Function *, 8> Readers;
+    for (BasicBlock *BB : Guards)
+      Readers.insert(BB->getParent());
+    // The dominator trees of the readers are asked for again when the next
+    // initialization function is looked at.
+    for (Function *Reader : Readers) {
+      removeUnreachableBlocks(*Reader);
+      FAM.invalidate(*Reader, PreservedAnalyses::none());
+    }
+  }
+
+  return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
 }
@@ -10,6 +10,38 @@ public:
   PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
 };
 
+// Give the calls of recognized CRC functions (crcu8 and its kind) vector
+// variants that LoopVectorize can map them to, on targets that select the
+// vector CRC intrinsic. The variants are new linkonce_odr functions kept
+// alive through llvm.compiler.used, so this runs on the whole module after
+// crc-recognition and before the vectorizer.
+class CRCVectorVariantsPass : public PassInfoMixin<CRCVectorVariantsPass> {
+public:
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+};
+
+// Evaluate functions that fill a CRC table at startup (zlib's make_crc_table,
+// or init_table() behind an "if (!table_ready)" guard) at compile time: the
+// globals they write start out with the values they would leave behind, the
+// calls of the function are deleted and the lazy initialization branches
+// fold away once the guard flag is constant.
+class CRCTableInitPass : public PassInfoMixin<CRCTableInitPass> {
+public:
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+};
+
+// Replace constant CRC tables of the module with the canonical table of
+// their CRC (the one -crc-lowering=table emits), which is linkonce_odr in a
+// comdat of its own, so that the linker keeps one copy per CRC no matter how
+// many translation units build or declare it. Tables that are no longer used
+// because their lookups were recognized as CRC steps are deleted. Meant for
+// the LTO pipelines, after GlobalOpt has marked the tables whose address is
+// not compared unnamed_addr.
+class CRCTableMergePass : public PassInfoMixin<CRCTableMergePass> {
+public:
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+};
+
 } // namespace llvm
 
 #endif // LLVM_TRANSFORMS_RECOGNIZINGCRC_RECOGNIZINGCRC_H
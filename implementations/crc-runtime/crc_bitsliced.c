@@ -0,0 +1,144 @@
+#include "crc_runtime.h"
+#include <string.h>
+
+/* Messages per group: 64 * CRC_SLICE_WORDS, one bit of a word per message. */
+#define CRC_SLICE_WORDS 4
+#define CRC_SLICE_LANES (64 * CRC_SLICE_WORDS)
+
+/* Below this many messages the transposition costs more than it saves. */
+#define CRC_BITSLICE_MIN_COUNT 8
+
+/*
+ * One byte step of a CRC is linear over GF(2). With t the eight bits the
+ * data byte is combined with (the low register bits for reflected CRCs, the
+ * high ones otherwise), the new register is the old one shifted by eight
+ * positions XORed with the step of every set bit of t. columns[i] has bit b
+ * set when bit b of t flips bit i of the new register.
+ */
+struct crc_network {
+  unsigned width;
+  int refin;
+  uint8_t columns[64];
+};
+
+static void build_network(const struct crc_descriptor *desc,
+                          struct crc_network *net) {
+  net->width = desc->width;
+  net->refin = desc->refin;
+  memset(net->columns, 0, sizeof(net->columns));
+  for (unsigned b = 0; b < 8; b++) {
+    /* With a zero register the byte itself is t. */
+    unsigned char byte = (unsigned char)(1u << b);
+    uint64_t column = __crc_update_bitwise(desc, 0, &byte, 1);
+    for (unsigned i = 0; i < desc->width; i++)
+      if ((column >> i) & 1)
+        net->columns[i] |= (uint8_t)(1u << b);
+  }
+}
+
+/*
+ * Transpose an 8x8 bit matrix held in x, one row per byte, so that byte b of
+ * the result collects bit b of every input byte (Hacker's Delight 7-3).
+ */
+static uint64_t transpose8x8(uint64_t x) {
+  uint64_t t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+  x ^= t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+  x ^= t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+  x ^= t ^ (t << 28);
+  return x;
+}
+
+/*
+ * Slice byte pos of nlanes messages: bit l of data[b][w] becomes bit b of the
+ * byte of message 64 * w + l. Missing lanes read as zero.
+ */
+static void slice_bytes(const unsigned char *msgs, size_t stride, size_t pos,
+                        size_t nlanes, uint64_t data[8][CRC_SLICE_WORDS]) {
+  memset(data, 0, sizeof(uint64_t) * 8 * CRC_SLICE_WORDS);
+  for (size_t lane = 0; lane < nlanes; lane += 8) {
+    uint64_t rows = 0;
+    for (size_t k = 0; k < 8 && lane + k < nlanes; k++)
+      rows |= (uint64_t)msgs[(lane + k) * stride + pos] << (8 * k);
+    uint64_t columns = transpose8x8(rows);
+    for (unsigned b = 0; b < 8; b++)
+      data[b][lane / 64] |= ((columns >> (8 * b)) & 0xff) << (lane % 64);
+  }
+}
+
+static void store_crc(void *crcs, unsigned width, size_t index, uint64_t crc) {
+  if (width <= 8)
+    ((uint8_t *)crcs)[index] = (uint8_t)crc;
+  else if (width <= 16)
+    ((uint16_t *)crcs)[index] = (uint16_t)crc;
+  else if (width <= 32)
+    ((uint32_t *)crcs)[index] = (uint32_t)crc;
+  else
+    ((uint64_t *)crcs)[index] = crc;
+}
+
+static void bitsliced_group(const struct crc_network *net,
+                            const unsigned char *msgs, size_t stride,
+                            size_t len, uint64_t crc, void *crcs,
+                            size_t first, size_t nlanes) {
+  unsigned width = net->width;
+  uint64_t reg[64][CRC_SLICE_WORDS], next[64][CRC_SLICE_WORDS];
+  uint64_t data[8][CRC_SLICE_WORDS], t[8][CRC_SLICE_WORDS];
+
+  for (unsigned i = 0; i < width; i++)
+    for (unsigned w = 0; w < CRC_SLICE_WORDS; w++)
+      reg[i][w] = ((crc >> i) & 1) ? ~(uint64_t)0 : 0;
+
+  for (size_t pos = 0; pos < len; pos++) {
+    slice_bytes(msgs + first * stride, stride, pos, nlanes, data);
+
+    /* Register bit of t[b]: b for reflected CRCs, b + width - 8 otherwise. */
+    int offset = net->refin ? 0 : (int)width - 8;
+    for (int b = 0; b < 8; b++)
+      for (unsigned w = 0; w < CRC_SLICE_WORDS; w++)
+        t[b][w] = data[b][w] ^ (b + offset >= 0 && b + offset < (int)width
+                                    ? reg[b + offset][w]
+                                    : 0);
+
+    for (unsigned i = 0; i < width; i++) {
+      /* Bit i of the register shifted by eight. */
+      int from = net->refin ? (int)i + 8 : (int)i - 8;
+      for (unsigned w = 0; w < CRC_SLICE_WORDS; w++)
+        next[i][w] = from >= 0 && from < (int)width ? reg[from][w] : 0;
+      for (unsigned b = 0; b < 8; b++)
+        if ((net->columns[i] >> b) & 1)
+          for (unsigned w = 0; w < CRC_SLICE_WORDS; w++)
+            next[i][w] ^= t[b][w];
+    }
+    memcpy(reg, next, sizeof(reg[0]) * width);
+  }
+
+  for (size_t lane = 0; lane < nlanes; lane++) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i < width; i++)
+      value |= ((reg[i][lane / 64] >> (lane % 64)) & 1) << i;
+    store_crc(crcs, width, first + lane, value);
+  }
+}
+
+void __crc_bitsliced_batch(const struct crc_descriptor *desc,
+                           const unsigned char *msgs, size_t stride,
+                           size_t len, uint64_t crc, void *crcs,
+                           size_t count) {
+  if (count < CRC_BITSLICE_MIN_COUNT) {
+    for (size_t i = 0; i < count; i++)
+      store_crc(crcs, desc->width, i,
+                __crc_update_bitwise(desc, crc, msgs + i * stride, len));
+    return;
+  }
+
+  struct crc_network net;
+  build_network(desc, &net);
+  for (size_t first = 0; first < count; first += CRC_SLICE_LANES) {
+    size_t nlanes = count - first < CRC_SLICE_LANES ? count - first
+                                                    : CRC_SLICE_LANES;
+    bitsliced_group(&net, msgs, stride, len, crc, crcs, first, nlanes);
+  }
+}
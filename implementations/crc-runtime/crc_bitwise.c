@@ -0,0 +1,42 @@
+#include "crc_internal.h"
+
+uint64_t __crc_init(const struct crc_descriptor *desc) {
+  uint64_t init = desc->init & crc_width_mask(desc->width);
+  return desc->refin ? crc_reflect(init, desc->width) : init;
+}
+
+uint64_t __crc_final(const struct crc_descriptor *desc, uint64_t crc) {
+  crc &= crc_width_mask(desc->width);
+  if (desc->refin != desc->refout)
+    crc = crc_reflect(crc, desc->width);
+  return (crc ^ desc->xorout) & crc_width_mask(desc->width);
+}
+
+uint64_t __crc_update_bitwise(const struct crc_descriptor *desc, uint64_t crc,
+                              const unsigned char *buf, size_t len) {
+  unsigned width = desc->width;
+  uint64_t mask = crc_width_mask(width);
+
+  crc &= mask;
+  if (desc->refin) {
+    uint64_t poly = crc_reflect(desc->poly, width);
+    for (size_t n = 0; n < len; n++) {
+      crc ^= buf[n];
+      for (int i = 0; i < 8; i++)
+        crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+    }
+    return crc;
+  }
+
+  uint64_t top = (uint64_t)1 << (width - 1);
+  for (size_t n = 0; n < len; n++) {
+    for (int i = 7; i >= 0; i--) {
+      uint64_t bit = (buf[n] >> i) & 1;
+      uint64_t carry = ((crc & top) != 0) ^ bit;
+      crc = (crc << 1) & mask;
+      if (carry)
+        crc ^= desc->poly & mask;
+    }
+  }
+  return crc;
+}
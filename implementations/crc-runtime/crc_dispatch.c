@@ -0,0 +1,159 @@
+#include "crc_internal.h"
+#include <stdlib.h>
+
+#if defined(__riscv) && defined(__linux__) && __has_include(<asm/hwprobe.h>)
+#include <asm/hwprobe.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define CRC_HAVE_HWPROBE 1
+#endif
+
+static uint64_t kernel_bitwise(const struct crc_context *ctx, uint64_t crc,
+                               const unsigned char *buf, size_t len) {
+  return __crc_update_bitwise(&ctx->desc, crc, buf, len);
+}
+
+static int is_crc32c(const struct crc_descriptor *desc) {
+  return desc->width == 32 && desc->refin && desc->poly == 0x1EDC6F41;
+}
+
+#if defined(CRC_HAVE_HWPROBE)
+static uint64_t riscv_extensions(void) {
+  struct riscv_hwprobe pair = {RISCV_HWPROBE_KEY_IMA_EXT_0, 0};
+  if (syscall(__NR_riscv_hwprobe, &pair, 1, 0, NULL, 0) != 0)
+    return 0;
+  return pair.value;
+}
+#endif
+
+struct crc_kernel {
+  const char *name;
+  crc_kernel_fn fn;
+  int usable;
+};
+
+/* Pick the first usable kernel, or the one CRC_RUNTIME_KERNEL names. */
+static void select_kernel(struct crc_context *ctx) {
+  const struct crc_descriptor *desc = &ctx->desc;
+  struct crc_kernel kernels[8];
+  int n = 0;
+  (void)desc;
+
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  int pclmul = __builtin_cpu_supports("pclmul");
+  kernels[n++] = (struct crc_kernel){
+      "sse42", __crc_kernel_sse42,
+      __builtin_cpu_supports("sse4.2") && is_crc32c(desc)};
+  kernels[n++] = (struct crc_kernel){
+      "vpclmul", __crc_kernel_vpclmul,
+      pclmul && __builtin_cpu_supports("avx512f") &&
+          __builtin_cpu_supports("avx512bw") &&
+          __builtin_cpu_supports("vpclmulqdq")};
+  kernels[n++] = (struct crc_kernel){"pclmul", __crc_kernel_pclmul, pclmul};
+#endif
+#if defined(__riscv) && __riscv_xlen == 64
+  uint64_t extensions = 0;
+#if defined(CRC_HAVE_HWPROBE)
+  extensions = riscv_extensions();
+#endif
+#if defined(__riscv_zvbc) && defined(RISCV_HWPROBE_EXT_ZVBC)
+  kernels[n++] = (struct crc_kernel){
+      "zvbc", __crc_kernel_zvbc, (extensions & RISCV_HWPROBE_EXT_ZVBC) != 0};
+#endif
+#if defined(RISCV_HWPROBE_EXT_ZBC)
+  kernels[n++] = (struct crc_kernel){
+      "zbc", __crc_kernel_zbc, (extensions & RISCV_HWPROBE_EXT_ZBC) != 0};
+#endif
+  (void)extensions;
+#endif
+  kernels[n++] = (struct crc_kernel){"slicing", __crc_kernel_slicing, 1};
+  kernels[n++] = (struct crc_kernel){"bitwise", kernel_bitwise, 1};
+
+  const char *forced = getenv("CRC_RUNTIME_KERNEL");
+  const struct crc_kernel *chosen = NULL;
+  for (int i = 0; i < n && forced; i++)
+    if (kernels[i].usable && !strcmp(kernels[i].name, forced))
+      chosen = &kernels[i];
+  for (int i = 0; i < n && !chosen; i++)
+    if (kernels[i].usable)
+      chosen = &kernels[i];
+
+  ctx->kernel = chosen->fn;
+  ctx->kernel_name = chosen->name;
+}
+
+/*
+ * Contexts are built once per descriptor and published in a small lock-free
+ * cache; programs rarely use more than a couple of CRCs. When the cache is
+ * full, each thread keeps one more context of its own.
+ */
+#define CRC_CONTEXT_CACHE 8
+static struct crc_context *context_cache[CRC_CONTEXT_CACHE];
+static _Thread_local struct crc_context *spare_context;
+
+static int same_registers(const struct crc_descriptor *a,
+                          const struct crc_descriptor *b) {
+  /* init, refout and xorout do not change how the register is updated. */
+  return a->width == b->width && !a->refin == !b->refin &&
+         (a->poly & crc_width_mask(a->width)) ==
+             (b->poly & crc_width_mask(b->width));
+}
+
+static struct crc_context *new_context(const struct crc_descriptor *desc) {
+  struct crc_context *ctx = malloc(sizeof(*ctx));
+  if (ctx) {
+    __crc_context_init(ctx, desc);
+    select_kernel(ctx);
+  }
+  return ctx;
+}
+
+static const struct crc_context *get_context(const struct crc_descriptor *desc) {
+  int slot = 0;
+  for (; slot < CRC_CONTEXT_CACHE; slot++) {
+    struct crc_context *ctx =
+        __atomic_load_n(&context_cache[slot], __ATOMIC_ACQUIRE);
+    if (!ctx)
+      break;
+    if (same_registers(&ctx->desc, desc))
+      return ctx;
+  }
+
+  if (spare_context && same_registers(&spare_context->desc, desc))
+    return spare_context;
+
+  struct crc_context *ctx = new_context(desc);
+  if (!ctx)
+    return NULL;
+
+  for (; slot < CRC_CONTEXT_CACHE; slot++) {
+    struct crc_context *expected = NULL;
+    if (__atomic_compare_exchange_n(&context_cache[slot], &expected, ctx, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      return ctx;
+    /* Another thread filled the slot first, maybe for the same CRC. */
+    if (same_registers(&expected->desc, desc)) {
+      free(ctx);
+      return expected;
+    }
+  }
+
+  free(spare_context);
+  spare_context = ctx;
+  return ctx;
+}
+
+uint64_t __crc_update(const struct crc_descriptor *desc, uint64_t crc,
+                      const unsigned char *buf, size_t len) {
+  crc &= crc_width_mask(desc->width);
+  const struct crc_context *ctx = get_context(desc);
+  if (!ctx)
+    return __crc_update_bitwise(desc, crc, buf, len);
+  return ctx->kernel(ctx, crc, buf, len);
+}
+
+const char *__crc_kernel_name(const struct crc_descriptor *desc) {
+  const struct crc_context *ctx = get_context(desc);
+  return ctx ? ctx->kernel_name : "bitwise";
+}
@@ -0,0 +1,125 @@
+#ifndef CRC_INTERNAL_H
+#define CRC_INTERNAL_H
+
+#include "crc_runtime.h"
+#include <string.h>
+
+/* Helpers shared by the kernels of the CRC runtime. */
+
+static inline uint64_t crc_width_mask(unsigned width) {
+  return width == 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+}
+
+/* Reverse the order of the low width bits of v. */
+static inline uint64_t crc_reflect(uint64_t v, unsigned width) {
+  uint64_t r = 0;
+  for (unsigned i = 0; i < width; i++, v >>= 1)
+    r = (r << 1) | (v & 1);
+  return r;
+}
+
+/* Load eight bytes as the first one being the least significant. */
+static inline uint64_t crc_load_le64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+/* Load eight bytes as the first one being the most significant. */
+static inline uint64_t crc_load_be64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+/*
+ * Everything a kernel needs for one descriptor, computed once per descriptor.
+ *
+ * Kernels take and return the register like __crc_update does. Internally
+ * the tables of MSB-first CRCs work on the register left aligned in 64 bits
+ * (register << (64 - width)), which makes every width look like a 64 bit CRC
+ * with the polynomial poly << (64 - width).
+ */
+struct crc_context;
+typedef uint64_t (*crc_kernel_fn)(const struct crc_context *ctx, uint64_t crc,
+                                  const unsigned char *buf, size_t len);
+
+struct crc_context {
+  struct crc_descriptor desc;
+  /* Slicing-by-8: table[k][b] is byte b followed by k zero bytes. */
+  uint64_t table[8][256];
+  /*
+   * Barrett reduction of 64 data bits (see crc_barrett.inc): the low 64 bits
+   * of floor(x^(width + 64) / P) and of the polynomial, both reflected for
+   * reflected CRCs.
+   */
+  uint64_t barrett_quotient;
+  uint64_t barrett_poly;
+  crc_kernel_fn kernel;
+  const char *kernel_name;
+};
+
+void __crc_context_init(struct crc_context *ctx,
+                        const struct crc_descriptor *desc);
+
+/* Byte by byte update with table[0], for the bytes the kernels leave over. */
+static inline uint64_t crc_update_bytes(const struct crc_context *ctx,
+                                        uint64_t crc, const unsigned char *buf,
+                                        size_t len) {
+  if (ctx->desc.refin) {
+    for (size_t i = 0; i < len; i++)
+      crc = (crc >> 8) ^ ctx->table[0][(crc ^ buf[i]) & 0xff];
+  } else {
+    unsigned shift = 64 - ctx->desc.width;
+    crc <<= shift;
+    for (size_t i = 0; i < len; i++)
+      crc = (crc << 8) ^ ctx->table[0][(crc >> 56) ^ buf[i]];
+    crc >>= shift;
+  }
+  return crc;
+}
+
+/* x^(8n) mod P, the polynomial n zero bytes multiply the register by. */
+uint64_t __crc_zeros_multiplier(const struct crc_descriptor *desc, uint64_t n);
+
+/* The register crc times multiplier (from __crc_zeros_multiplier) mod P. */
+uint64_t __crc_multiply(const struct crc_descriptor *desc, uint64_t crc,
+                        uint64_t multiplier);
+
+/*
+ * Combine the register crc of a message A with the register crc_b of a
+ * message B computed from a zero register, giving the register of A followed
+ * by B. multiplier is __crc_zeros_multiplier of the length of B.
+ */
+static inline uint64_t crc_combine(const struct crc_context *ctx, uint64_t crc,
+                                   uint64_t crc_b, uint64_t multiplier) {
+  return __crc_multiply(&ctx->desc, crc, multiplier) ^ crc_b;
+}
+
+/* Kernels. Each returns the updated register for any length. */
+uint64_t __crc_kernel_slicing(const struct crc_context *ctx, uint64_t crc,
+                              const unsigned char *buf, size_t len);
+#if defined(__x86_64__)
+uint64_t __crc_kernel_sse42(const struct crc_context *ctx, uint64_t crc,
+                            const unsigned char *buf, size_t len);
+uint64_t __crc_kernel_pclmul(const struct crc_context *ctx, uint64_t crc,
+                             const unsigned char *buf, size_t len);
+uint64_t __crc_kernel_vpclmul(const struct crc_context *ctx, uint64_t crc,
+                              const unsigned char *buf, size_t len);
+#endif
+#if defined(__riscv) && __riscv_xlen == 64
+uint64_t __crc_kernel_zbc(const struct crc_context *ctx, uint64_t crc,
+                          const unsigned char *buf, size_t len);
+#if defined(__riscv_zvbc)
+uint64_t __crc_kernel_zvbc(const struct crc_context *ctx, uint64_t crc,
+                           const unsigned char *buf, size_t len);
+#endif
+#endif
+
+#endif /* CRC_INTERNAL_H */
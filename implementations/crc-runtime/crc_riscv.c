@@ -0,0 +1,91 @@
+#include "crc_internal.h"
+
+#if defined(__riscv) && __riscv_xlen == 64
+
+/*
+ * The instructions are enabled for these few lines only, so the library can
+ * be built for plain rv64gc and still use Zbc where the dispatcher finds it.
+ */
+static inline uint64_t zbc_clmul(uint64_t a, uint64_t b) {
+  uint64_t r;
+  __asm__(".option push\n"
+          ".option arch, +zbc\n"
+          "clmul %0, %1, %2\n"
+          ".option pop"
+          : "=r"(r)
+          : "r"(a), "r"(b));
+  return r;
+}
+
+static inline uint64_t zbc_clmulh(uint64_t a, uint64_t b) {
+  uint64_t r;
+  __asm__(".option push\n"
+          ".option arch, +zbc\n"
+          "clmulh %0, %1, %2\n"
+          ".option pop"
+          : "=r"(r)
+          : "r"(a), "r"(b));
+  return r;
+}
+
+#define CRC_BARRETT_KERNEL __crc_kernel_zbc
+#define CRC_BARRETT_ATTRIBUTES
+#define crc_clmul_lo zbc_clmul
+#define crc_clmul_hi zbc_clmulh
+#include "crc_barrett.inc"
+#undef CRC_BARRETT_KERNEL
+#undef CRC_BARRETT_ATTRIBUTES
+#undef crc_clmul_lo
+#undef crc_clmul_hi
+
+#if defined(__riscv_zvbc)
+#include <riscv_vector.h>
+
+/*
+ * Zvbc: one part of the buffer per 64 bit element, loaded with a strided
+ * load, so the Barrett steps of crc_barrett.inc run in all elements at once.
+ * Only reflected CRCs are handled here, the MSB-first ones would need a byte
+ * swap of every element, which Zvbc does not have; they use Zbc.
+ * This file has to be compiled with Zvbc enabled (e.g. -march=rv64gcv_zvbc);
+ * the dispatcher only calls the kernel where hwprobe reports Zvbc.
+ */
+#define ZVBC_MAX_STREAMS 8
+#define ZVBC_MIN 4096
+
+uint64_t __crc_kernel_zvbc(const struct crc_context *ctx, uint64_t crc,
+                           const unsigned char *buf, size_t len) {
+  size_t streams = __riscv_vsetvlmax_e64m1();
+  if (streams > ZVBC_MAX_STREAMS)
+    streams = ZVBC_MAX_STREAMS;
+  if (!ctx->desc.refin || streams < 2 || len < ZVBC_MIN)
+    return __crc_kernel_zbc(ctx, crc, buf, len);
+
+  size_t part = len / (8 * streams) * 8;
+  uint64_t mu = ctx->barrett_quotient;
+  uint64_t poly = ctx->barrett_poly;
+  uint64_t top = ctx->desc.width == 64 && (ctx->desc.poly & 1) ? ~(uint64_t)0 : 0;
+
+  uint64_t parts[ZVBC_MAX_STREAMS] = {crc};
+  vuint64m1_t crcs = __riscv_vle64_v_u64m1(parts, streams);
+  for (size_t i = 0; i < part; i += 8) {
+    vuint64m1_t data =
+        __riscv_vlse64_v_u64m1((const uint64_t *)(buf + i), part, streams);
+    vuint64m1_t q = __riscv_vclmul_vx_u64m1(
+        __riscv_vxor_vv_u64m1(crcs, data, streams), mu, streams);
+    crcs = __riscv_vxor_vv_u64m1(__riscv_vclmulh_vx_u64m1(q, poly, streams),
+                                 __riscv_vand_vx_u64m1(q, top, streams),
+                                 streams);
+  }
+  __riscv_vse64_v_u64m1(parts, crcs, streams);
+
+  uint64_t multiplier = __crc_zeros_multiplier(&ctx->desc, part);
+  crc = parts[0];
+  for (size_t s = 1; s < streams; s++)
+    crc = crc_combine(ctx, crc, parts[s], multiplier);
+
+  return __crc_kernel_zbc(ctx, crc, buf + streams * part,
+                          len - streams * part);
+}
+#endif /* __riscv_zvbc */
+
+#endif /* __riscv && __riscv_xlen == 64 */
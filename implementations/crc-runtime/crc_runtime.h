@@ -0,0 +1,86 @@
+#ifndef CRC_RUNTIME_H
+#define CRC_RUNTIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Parameters of a CRC algorithm in the Rocksoft model. poly is written
+ * MSB-first without the x^width term, e.g. CRC-16/ARC (the CRC crcu8
+ * computes) is {16, 1, 1, 0x8005, 0x0000, 0x0000}.
+ *
+ * The layout is shared with the compiler, which emits constant descriptors as
+ * { i32, i32, i32, i64, i64, i64 } when it lowers CRC loops to calls of this
+ * library, so the fields must not be reordered.
+ */
+struct crc_descriptor {
+  unsigned width; /* 1 to 64 */
+  int refin;
+  int refout;
+  uint64_t poly;
+  uint64_t init;
+  uint64_t xorout;
+};
+
+/*
+ * All update functions work on the CRC register the way crcu8 does: the value
+ * is reflected when refin is set and neither init nor xorout is applied.
+ * __crc_init and __crc_final convert between the register and the values of
+ * the Rocksoft model, so the CRC of a whole message is
+ *   __crc_final(d, __crc_update_bitwise(d, __crc_init(d), buf, len))
+ */
+uint64_t __crc_init(const struct crc_descriptor *desc);
+uint64_t __crc_final(const struct crc_descriptor *desc, uint64_t crc);
+
+/*
+ * Update the register with len bytes using the fastest kernel the host CPU
+ * supports for the descriptor: SSE4.2 crc32 (CRC-32C only), AVX-512 VPCLMUL,
+ * PCLMUL, Zvbc or Zbc carry-less multiplication, or slicing-by-8 tables.
+ * The kernel and the per-descriptor tables and constants are chosen on the
+ * first call and cached. Setting CRC_RUNTIME_KERNEL to one of the names
+ * __crc_kernel_name returns forces a kernel, e.g. for benchmarking.
+ */
+uint64_t __crc_update(const struct crc_descriptor *desc, uint64_t crc,
+                      const unsigned char *buf, size_t len);
+
+/* Name of the kernel __crc_update uses for the descriptor. */
+const char *__crc_kernel_name(const struct crc_descriptor *desc);
+
+/* Bit by bit reference implementation, correct for every descriptor. */
+uint64_t __crc_update_bitwise(const struct crc_descriptor *desc, uint64_t crc,
+                              const unsigned char *buf, size_t len);
+
+/*
+ * Update the register with n zero bytes in O(log n) steps: the bytes multiply
+ * the register by x^(8n) mod P. Padding and zero-filled blocks cost the same
+ * no matter how long they are.
+ */
+uint64_t __crc_update_zeros(const struct crc_descriptor *desc, uint64_t crc,
+                            uint64_t n);
+
+/*
+ * Update count independent CRC registers, all starting from crc, with the
+ * messages msgs, msgs + stride, msgs + 2 * stride, ..., each len bytes long.
+ * The results are stored to crcs as an array of the smallest of uint8_t,
+ * uint16_t, uint32_t and uint64_t that holds width bits.
+ *
+ * Meant for many short messages (packets, frames, headers), where the setup
+ * of table or carry-less multiplication based code does not pay off: up to
+ * 256 messages are transposed so that each bit position of the data and of
+ * the registers is a bit vector with one bit per message, and every step is
+ * an XOR network over these vectors derived from the descriptor.
+ */
+void __crc_bitsliced_batch(const struct crc_descriptor *desc,
+                           const unsigned char *msgs, size_t stride,
+                           size_t len, uint64_t crc, void *crcs,
+                           size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC_RUNTIME_H */
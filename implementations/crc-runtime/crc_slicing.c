@@ -0,0 +1,99 @@
+#include "crc_internal.h"
+
+/* Multiply a register by x mod P, reflected or left aligned. */
+static uint64_t times_x(const struct crc_descriptor *desc, uint64_t reg) {
+  if (desc->refin) {
+    uint64_t poly = crc_reflect(desc->poly, desc->width);
+    return (reg >> 1) ^ ((reg & 1) ? poly : 0);
+  }
+  uint64_t poly = desc->poly << (64 - desc->width);
+  return (reg << 1) ^ ((reg >> 63) ? poly : 0);
+}
+
+/*
+ * Carry-less multiplication kernels compute a step over 64 data bits by
+ * Barrett reduction: with T the 64 data bits XORed with the register,
+ * q = floor(T * mu / x^64) is the quotient of T * x^width by P and the
+ * remainder is the low bits of q * P. This computes mu = floor(x^(width + 64)
+ * / P), a polynomial of degree 64 whose x^64 term the kernels do not need.
+ */
+static void init_barrett(struct crc_context *ctx) {
+  const struct crc_descriptor *desc = &ctx->desc;
+  unsigned width = desc->width;
+
+  /* Long division; rem holds the top width bits of the running remainder. */
+  uint64_t poly = desc->poly & crc_width_mask(width);
+  uint64_t rem = poly; /* x^width mod P */
+  uint64_t quotient = 0;
+  for (int bit = 63; bit >= 0; bit--) {
+    uint64_t carry = (rem >> (width - 1)) & 1;
+    rem = (rem << 1) & crc_width_mask(width);
+    if (carry) {
+      rem ^= poly;
+      quotient |= (uint64_t)1 << bit;
+    }
+  }
+  /* The x^64 term is always set; the kernels drop it. */
+
+  if (desc->refin) {
+    /* Reflect the 65 bits of mu: x^64 becomes bit 0, bit i becomes 64 - i. */
+    ctx->barrett_quotient = (crc_reflect(quotient, 64) << 1) | 1;
+    ctx->barrett_poly = (crc_reflect(poly, width) << 1) | 1;
+  } else {
+    ctx->barrett_quotient = quotient;
+    ctx->barrett_poly = poly;
+  }
+}
+
+void __crc_context_init(struct crc_context *ctx,
+                        const struct crc_descriptor *desc) {
+  ctx->desc = *desc;
+  ctx->desc.poly &= crc_width_mask(desc->width);
+
+  for (unsigned b = 0; b < 256; b++) {
+    uint64_t reg = desc->refin ? b : (uint64_t)b << 56;
+    for (int i = 0; i < 8; i++)
+      reg = times_x(&ctx->desc, reg);
+    ctx->table[0][b] = reg;
+  }
+  for (unsigned k = 1; k < 8; k++)
+    for (unsigned b = 0; b < 256; b++) {
+      uint64_t prev = ctx->table[k - 1][b];
+      ctx->table[k][b] =
+          desc->refin ? (prev >> 8) ^ ctx->table[0][prev & 0xff]
+                      : (prev << 8) ^ ctx->table[0][prev >> 56];
+    }
+
+  init_barrett(ctx);
+  ctx->kernel = __crc_kernel_slicing;
+  ctx->kernel_name = "slicing";
+}
+
+uint64_t __crc_kernel_slicing(const struct crc_context *ctx, uint64_t crc,
+                              const unsigned char *buf, size_t len) {
+  const uint64_t(*t)[256] = ctx->table;
+  size_t blocks = len / 8;
+
+  if (ctx->desc.refin) {
+    for (size_t i = 0; i < blocks; i++, buf += 8) {
+      crc ^= crc_load_le64(buf);
+      crc = t[7][crc & 0xff] ^ t[6][(crc >> 8) & 0xff] ^
+            t[5][(crc >> 16) & 0xff] ^ t[4][(crc >> 24) & 0xff] ^
+            t[3][(crc >> 32) & 0xff] ^ t[2][(crc >> 40) & 0xff] ^
+            t[1][(crc >> 48) & 0xff] ^ t[0][crc >> 56];
+    }
+  } else {
+    unsigned shift = 64 - ctx->desc.width;
+    crc <<= shift;
+    for (size_t i = 0; i < blocks; i++, buf += 8) {
+      crc ^= crc_load_be64(buf);
+      crc = t[7][crc >> 56] ^ t[6][(crc >> 48) & 0xff] ^
+            t[5][(crc >> 40) & 0xff] ^ t[4][(crc >> 32) & 0xff] ^
+            t[3][(crc >> 24) & 0xff] ^ t[2][(crc >> 16) & 0xff] ^
+            t[1][(crc >> 8) & 0xff] ^ t[0][crc & 0xff];
+    }
+    crc >>= shift;
+  }
+
+  return crc_update_bytes(ctx, crc, buf, len % 8);
+}
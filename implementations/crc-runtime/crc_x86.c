@@ -0,0 +1,132 @@
+#include "crc_internal.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+/*
+ * The crc32 instruction computes CRC-32C (Castagnoli) and nothing else. It has
+ * a latency of three cycles and a throughput of one, so long buffers are
+ * split into three parts that are computed side by side and combined.
+ */
+#define SSE42_STREAMS 3
+#define SSE42_STREAM_MIN 1024
+
+__attribute__((target("sse4.2")))
+uint64_t __crc_kernel_sse42(const struct crc_context *ctx, uint64_t crc,
+                            const unsigned char *buf, size_t len) {
+  if (len >= SSE42_STREAM_MIN) {
+    size_t part = len / (8 * SSE42_STREAMS) * 8;
+    uint64_t crc1 = 0, crc2 = 0;
+    for (size_t i = 0; i < part; i += 8) {
+      crc = _mm_crc32_u64(crc, crc_load_le64(buf + i));
+      crc1 = _mm_crc32_u64(crc1, crc_load_le64(buf + part + i));
+      crc2 = _mm_crc32_u64(crc2, crc_load_le64(buf + 2 * part + i));
+    }
+
+    uint64_t multiplier = __crc_zeros_multiplier(&ctx->desc, part);
+    crc = crc_combine(ctx, crc, crc1, multiplier);
+    crc = crc_combine(ctx, crc, crc2, multiplier);
+    buf += SSE42_STREAMS * part;
+    len -= SSE42_STREAMS * part;
+  }
+
+  for (; len >= 8; len -= 8, buf += 8)
+    crc = _mm_crc32_u64(crc, crc_load_le64(buf));
+  for (; len; len--, buf++)
+    crc = _mm_crc32_u8((uint32_t)crc, *buf);
+  return crc;
+}
+
+__attribute__((target("pclmul")))
+static inline uint64_t pclmul_lo(uint64_t a, uint64_t b) {
+  __m128i p = _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)a),
+                                   _mm_cvtsi64_si128((long long)b), 0x00);
+  return (uint64_t)_mm_cvtsi128_si64(p);
+}
+
+__attribute__((target("pclmul")))
+static inline uint64_t pclmul_hi(uint64_t a, uint64_t b) {
+  __m128i p = _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)a),
+                                   _mm_cvtsi64_si128((long long)b), 0x00);
+  return (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(p, p));
+}
+
+#define CRC_BARRETT_KERNEL __crc_kernel_pclmul
+#define CRC_BARRETT_ATTRIBUTES __attribute__((target("pclmul")))
+#define crc_clmul_lo pclmul_lo
+#define crc_clmul_hi pclmul_hi
+#include "crc_barrett.inc"
+#undef CRC_BARRETT_KERNEL
+#undef CRC_BARRETT_ATTRIBUTES
+#undef crc_clmul_lo
+#undef crc_clmul_hi
+
+/*
+ * AVX-512 VPCLMULQDQ multiplies in all four 128 bit lanes of a register at
+ * once, so eight parts of the buffer (two per lane) run the Barrett steps of
+ * crc_barrett.inc side by side. The parts are combined at the end and the
+ * rest of the buffer goes to the PCLMUL kernel.
+ */
+#define VPCLMUL_STREAMS 8
+#define VPCLMUL_MIN 4096
+
+__attribute__((target("avx512f,avx512bw,vpclmulqdq,pclmul")))
+uint64_t __crc_kernel_vpclmul(const struct crc_context *ctx, uint64_t crc,
+                              const unsigned char *buf, size_t len) {
+  if (len < VPCLMUL_MIN)
+    return __crc_kernel_pclmul(ctx, crc, buf, len);
+
+  size_t part = len / (8 * VPCLMUL_STREAMS) * 8;
+  unsigned width = ctx->desc.width;
+  __m512i mu = _mm512_set1_epi64((long long)ctx->barrett_quotient);
+  __m512i poly = _mm512_set1_epi64((long long)ctx->barrett_poly);
+  __m512i offsets = _mm512_set_epi64(7 * part, 6 * part, 5 * part, 4 * part,
+                                     3 * part, 2 * part, part, 0);
+  __m512i crcs = _mm512_set_epi64(0, 0, 0, 0, 0, 0, 0, (long long)crc);
+
+  if (ctx->desc.refin) {
+    __m512i top = _mm512_set1_epi64(
+        width == 64 && (ctx->desc.poly & 1) ? -1LL : 0);
+    for (size_t i = 0; i < part; i += 8) {
+      __m512i t = _mm512_xor_si512(
+          crcs, _mm512_i64gather_epi64(offsets, buf + i, 1));
+      /* q = clmul_lo(t, mu) for the low and the high qword of each lane. */
+      __m512i q = _mm512_unpacklo_epi64(_mm512_clmulepi64_epi128(t, mu, 0x00),
+                                        _mm512_clmulepi64_epi128(t, mu, 0x01));
+      /* crc = clmul_hi(q, poly) */
+      crcs = _mm512_unpackhi_epi64(_mm512_clmulepi64_epi128(q, poly, 0x00),
+                                   _mm512_clmulepi64_epi128(q, poly, 0x01));
+      crcs = _mm512_xor_si512(crcs, _mm512_and_si512(q, top));
+    }
+  } else {
+    __m128i shift = _mm_cvtsi32_si128((int)(64 - width));
+    __m512i mask = _mm512_set1_epi64((long long)crc_width_mask(width));
+    __m512i bswap = _mm512_set4_epi32(0x08090a0b, 0x0c0d0e0f, 0x00010203,
+                                      0x04050607);
+    for (size_t i = 0; i < part; i += 8) {
+      __m512i data = _mm512_i64gather_epi64(offsets, buf + i, 1);
+      data = _mm512_shuffle_epi8(data, bswap);
+      __m512i t = _mm512_xor_si512(_mm512_sll_epi64(crcs, shift), data);
+      /* q = clmul_hi(t, mu) ^ t */
+      __m512i q = _mm512_unpackhi_epi64(_mm512_clmulepi64_epi128(t, mu, 0x00),
+                                        _mm512_clmulepi64_epi128(t, mu, 0x01));
+      q = _mm512_xor_si512(q, t);
+      /* crc = clmul_lo(q, poly) mod x^width */
+      crcs = _mm512_unpacklo_epi64(_mm512_clmulepi64_epi128(q, poly, 0x00),
+                                   _mm512_clmulepi64_epi128(q, poly, 0x01));
+      crcs = _mm512_and_si512(crcs, mask);
+    }
+  }
+
+  uint64_t parts[VPCLMUL_STREAMS];
+  _mm512_storeu_si512(parts, crcs);
+  uint64_t multiplier = __crc_zeros_multiplier(&ctx->desc, part);
+  crc = parts[0];
+  for (int s = 1; s < VPCLMUL_STREAMS; s++)
+    crc = crc_combine(ctx, crc, parts[s], multiplier);
+
+  return __crc_kernel_pclmul(ctx, crc, buf + VPCLMUL_STREAMS * part,
+                             len - VPCLMUL_STREAMS * part);
+}
+
+#endif /* __x86_64__ */
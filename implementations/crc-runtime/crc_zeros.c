@@ -0,0 +1,54 @@
+#include "crc_internal.h"
+
+/* a * x mod P, with a and the result MSB-first. */
+static uint64_t times_x(const struct crc_descriptor *desc, uint64_t a) {
+  uint64_t carry = (a >> (desc->width - 1)) & 1;
+  a = (a << 1) & crc_width_mask(desc->width);
+  return carry ? a ^ (desc->poly & crc_width_mask(desc->width)) : a;
+}
+
+/* a * b mod P by shift and add, MSB-first. */
+static uint64_t multiply(const struct crc_descriptor *desc, uint64_t a,
+                         uint64_t b) {
+  uint64_t product = 0;
+  for (unsigned i = desc->width; i-- > 0;) {
+    product = times_x(desc, product);
+    if ((b >> i) & 1)
+      product ^= a;
+  }
+  return product;
+}
+
+uint64_t __crc_zeros_multiplier(const struct crc_descriptor *desc, uint64_t n) {
+  uint64_t power = 1;
+  for (int i = 0; i < 8; i++)
+    power = times_x(desc, power);
+
+  uint64_t result = 1;
+  for (; n; n >>= 1) {
+    if (n & 1)
+      result = multiply(desc, result, power);
+    power = multiply(desc, power, power);
+  }
+  return result;
+}
+
+uint64_t __crc_multiply(const struct crc_descriptor *desc, uint64_t crc,
+                        uint64_t multiplier) {
+  unsigned width = desc->width;
+  crc &= crc_width_mask(width);
+  if (!desc->refin)
+    return multiply(desc, crc, multiplier);
+  return crc_reflect(multiply(desc, crc_reflect(crc, width), multiplier),
+                     width);
+}
+
+/*
+ * Feeding a zero byte into the register multiplies it by x^8 mod P, so n zero
+ * bytes multiply it by x^(8n) mod P, which square-and-multiply computes in
+ * O(log n) multiplications.
+ */
+uint64_t __crc_update_zeros(const struct crc_descriptor *desc, uint64_t crc,
+                            uint64_t n) {
+  return __crc_multiply(desc, crc, __crc_zeros_multiplier(desc, n));
+}
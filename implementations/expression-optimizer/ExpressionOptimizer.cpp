@@ -34,15 +34,8 @@
 using namespace llvm;
 using namespace PatternMatch;
 
-std::vector<StringRef> checkedFunctions;
-
 bool findBinomialSquare(Instruction &I){
     Function *F=I.getFunction();
-    
-    for(StringRef name: checkedFunctions){
-        if(F->getName()==name)
-            return false;
-    }
 
     ReturnInst *RI=dyn_cast<ReturnInst>(&I);
     if(!RI)
@@ -119,18 +112,16 @@ bool findBinomialSquare(Instruction &I){
     if(!AI)
         return false;            
 
-    checkedFunctions.push_back(F->getName());
+    // A lookup in the symbol table of the module, not a walk over all of
+    // its functions, since this runs once for every function.
+    Function *callee=F->getParent()->getFunction("f2");
+    if(!callee)
+        return false;
+
     Value *argument1=F->getArg(0);
     Value *argument2=F->getArg(1);
     
     IRBuilder<> B(IIfinal);
-    Module *M=F->getParent();
-    Function *callee;
-    for(Function &FF: *M){
-        if(FF.getName()=="f2"){
-            callee=&FF;
-        }    
-    }
 
     auto f2_call=B.CreateCall(FunctionCallee(callee), {argument1, argument2});
     IIfinal->replaceAllUsesWith(f2_call);
@@ -175,20 +166,16 @@ bool findBinomialSquare(Instruction &I){
 }
 
 PreservedAnalyses ExpressionOptimizerPass::run(Function &F, FunctionAnalysisManager &AM) {
-    Module *M=F.getParent();
-    for(Function &FF: *M){
-        if(FF.empty())
-            continue;
-
-        BasicBlock& BB=FF.back();
-        Instruction& I=BB.back();
-        bool flag=findBinomialSquare(I);
-        
-        if(flag){
-            errs() << "We have found a binomial square implementation!\n";
-            break;
-        }
-    }
-
-    return PreservedAnalyses::all();
+    // The pass manager calls this for every function of the module, so only
+    // F itself is looked at.
+    if(F.empty())
+        return PreservedAnalyses::all();
+
+    BasicBlock& BB=F.back();
+    Instruction& I=BB.back();
+    if(!findBinomialSquare(I))
+        return PreservedAnalyses::all();
+
+    errs() << "We have found a binomial square implementation!\n";
+    return PreservedAnalyses::none();
 }
\ No newline at end of file
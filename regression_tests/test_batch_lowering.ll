@@ -0,0 +1,53 @@
+; RUN: ../build/bin/opt -S -passes=crc-recognition -crc-batch %s 2>&1 | FileCheck %s
+; RUN: ../build/bin/opt -passes=crc-recognition -crc-batch -pass-remarks=crc-recognition -disable-output %s 2>&1 | FileCheck %s --check-prefix=REMARK
+
+; The CRCs of n 8-byte messages are computed by one call of the bit-sliced
+; runtime; the loop nest is deleted.
+; REMARK: remark: {{.*}} CRC loop over a batch of 8 byte messages replaced with the bit-sliced runtime
+
+; CHECK: @crc.descriptor.16.0x8005.11.0x0.0x0 = private unnamed_addr constant { i32, i32, i32, i64, i64, i64 } { i32 16, i32 1, i32 1, i64 32773, i64 0, i64 0 }
+
+; CHECK-LABEL: @frame_crcs(
+; CHECK: call void @__crc_bitsliced_batch(ptr @crc.descriptor.16.0x8005.11.0x0.0x0, ptr %msgs, i64 8, i64 8, i64 65535, ptr %crcs, i64 %n)
+; CHECK-NOT: @llvm.riscv.crc.petar
+; CHECK: ret void
+define dso_local void @frame_crcs(ptr noalias %msgs, ptr noalias %crcs, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %frame.ph, label %exit
+
+frame.ph:
+  br label %frame
+
+frame:
+  %m = phi i64 [ 0, %frame.ph ], [ %m.next, %frame.end ]
+  %msg.offset = mul nuw nsw i64 %m, 8
+  %msg = getelementptr inbounds i8, ptr %msgs, i64 %msg.offset
+  br label %byte
+
+byte:
+  %i = phi i64 [ 0, %frame ], [ %i.next, %byte ]
+  %crc = phi i16 [ -1, %frame ], [ %crc.next, %byte ]
+  %byte.ptr = getelementptr inbounds i8, ptr %msg, i64 %i
+  %data = load i8, ptr %byte.ptr, align 1
+  %crc.next = call i16 @llvm.riscv.crc.petar(i8 %data, i16 %crc)
+  %i.next = add nuw nsw i64 %i, 1
+  %byte.done = icmp eq i64 %i.next, 8
+  br i1 %byte.done, label %frame.end, label %byte
+
+frame.end:
+  %crc.lcssa = phi i16 [ %crc.next, %byte ]
+  %crc.ptr = getelementptr inbounds i16, ptr %crcs, i64 %m
+  store i16 %crc.lcssa, ptr %crc.ptr, align 2
+  %m.next = add nuw nsw i64 %m, 1
+  %frame.done = icmp eq i64 %m.next, %n
+  br i1 %frame.done, label %exit.loopexit, label %frame
+
+exit.loopexit:
+  br label %exit
+
+exit:
+  ret void
+}
+
+declare i16 @llvm.riscv.crc.petar(i8, i16)
@@ -0,0 +1,51 @@
+; RUN: ../build/bin/opt -S -passes=crc-recognition %s 2>&1 | FileCheck %s
+; RUN: ../build/bin/opt -passes=crc-recognition -pass-remarks=crc-recognition -disable-output %s 2>&1 | FileCheck %s --check-prefix=REMARK
+
+; crcu8 after the intrinsic based recognition has been applied to it.
+define dso_local zeroext i16 @crcu8(i8 zeroext %0, i16 zeroext %1) {
+  %3 = call i16 @llvm.riscv.crc.petar(i8 %0, i16 %1)
+  ret i16 %3
+}
+
+; CHECK-LABEL: @main(
+; CHECK-NOT: call {{.*}} @crcu8
+; CHECK: store i16 30621, ptr %report
+define dso_local i32 @main() {
+  %data = alloca i8, align 1
+  %crc = alloca i16, align 2
+  %report = alloca i16, align 2
+  store i8 -15, ptr %data, align 1
+  store i16 -25275, ptr %crc, align 2
+  %1 = load i8, ptr %data, align 1
+  %2 = load i16, ptr %crc, align 2
+  %3 = call zeroext i16 @crcu8(i8 zeroext %1, i16 zeroext %2)
+  store i16 %3, ptr %report, align 2
+  ret i32 0
+}
+
+@header = private unnamed_addr constant [4 x i8] c"CRC!", align 1
+
+; REMARK: remark: {{.*}} CRC over constant buffer header evaluated at compile time
+; CHECK-LABEL: @header_crc(
+; CHECK: for.end:
+; CHECK-NEXT: %next.lcssa = phi i16 [ 22853, %for.body ]
+define dso_local zeroext i16 @header_crc() {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %inc, %for.body ]
+  %crc = phi i16 [ -1, %entry ], [ %next, %for.body ]
+  %arrayidx = getelementptr inbounds [4 x i8], ptr @header, i64 0, i64 %i
+  %byte = load i8, ptr %arrayidx, align 1
+  %next = call i16 @llvm.riscv.crc.petar(i8 %byte, i16 %crc)
+  %inc = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %inc, 4
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %next.lcssa = phi i16 [ %next, %for.body ]
+  ret i16 %next.lcssa
+}
+
+declare i16 @llvm.riscv.crc.petar(i8, i16)
@@ -0,0 +1,39 @@
+; RUN: ../build/bin/opt -passes=crc-recognition -crc-zeros -pass-remarks=crc-recognition -disable-output %s 2>&1 | FileCheck %s
+; RUN: ../build/bin/opt -passes=crc-recognition -crc-zeros -disable-output %s 2>&1 | FileCheck %s --check-prefix=QUIET --allow-empty
+
+; Every function the pass changes gets a CRCCost remark with the static cost
+; of one call before and after, summed from the reciprocal throughputs TTI
+; gives its instructions. The 1000 steps of the loop below are folded to a
+; constant, so the estimate drops from thousands to (almost) nothing; the loop
+; is left to loop deletion and is not counted any more.
+; CHECK: remark: {{.*}}CRC in padding_crc lowered, estimated cost per call {{[1-9][0-9][0-9][0-9]+}} -> {{[0-9]}}{{$}}
+
+; Functions the pass leaves alone get no remark.
+; CHECK-NOT: CRC in no_crc lowered
+
+; The estimates are only computed when the remarks are asked for.
+; QUIET-NOT: remark:
+define dso_local zeroext i16 @padding_crc() {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i32 [ 0, %entry ], [ %inc, %for.body ]
+  %crc = phi i16 [ -1, %entry ], [ %next, %for.body ]
+  %next = call i16 @llvm.riscv.crc.petar(i8 0, i16 %crc)
+  %inc = add nuw nsw i32 %i, 1
+  %exitcond = icmp eq i32 %inc, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %next.lcssa = phi i16 [ %next, %for.body ]
+  ret i16 %next.lcssa
+}
+
+define dso_local i32 @no_crc(i32 %a, i32 %b) {
+entry:
+  %sum = add i32 %a, %b
+  ret i32 %sum
+}
+
+declare i16 @llvm.riscv.crc.petar(i8, i16)
@@ -1,22 +1,63 @@
-; RUN: ../build/bin/llc syrmia_crc_unoptimized.ll -print-after-all -debug %s 2>&1 | FileCheck %s
+; RUN: ../build/bin/llc -mtriple=riscv64 -mattr=+zbc %s -o - 2>&1 | FileCheck %s
+; RUN: ../build/bin/llvm-extract --func=crcu8 %s -S -o - | ../build/bin/llc -mtriple=riscv64 -o - | ../build/bin/llvm-mca -mtriple=riscv64 -mcpu=sifive-u74 - 2>&1 | FileCheck %s --check-prefix=MCA
+; RUN: ../build/bin/llvm-extract --func=crcu8_original %s -S -o - | ../build/bin/opt -O2 -S | ../build/bin/llc -mtriple=riscv64 -o - | ../build/bin/llvm-mca -mtriple=riscv64 -mcpu=sifive-u74 - 2>&1 | FileCheck %s --check-prefix=MCA-LOOP
 
-; CHECK: crcu8: 
-crcu8:  
-; CHECK-NEXT: li      a4, quotient
-   li      a4, quotient
-; CHECK-NEXT: li      a5, polynomial
-   li      a5, polynomial
-; CHECK-NEXT: xor     a0, a1, a0
-   xor     a0, a1, a0
-; CHECK-NEXT: clmul   a0, a0, a4
-   clmul   a0, a0, a4
-; CHECK-NEXT: srli    a0, a0, crc_size
-   srli    a0, a0, crc_size
-; CHECK-NEXT: clmul   a0, a0, a5
-   clmul   a0, a0, a5
-; CHECK-NEXT: slli    a0, a0, GET_MODE_BITSIZE (word_mode) - crc_size
-   slli    a0, a0, GET_MODE_BITSIZE (word_mode) - crc_size
-; CHECK-NEXT: srli    a0, a0, GET_MODE_BITSIZE (word_mode) - crc_size
-   srli    a0, a0, GET_MODE_BITSIZE (word_mode) - crc_size
+; The CRC-16/ARC step of crcu8 is selected as two carry-less multiplications
+; with the reflected Barrett constants 0x1ff and 0x14003. The arguments and
+; the result are zero extended already, so no masking is emitted for them.
+
+; CHECK-LABEL: crcu8:
+; CHECK-DAG: li      {{a[0-9]+}}, 511
+; CHECK-DAG: lui     {{a[0-9]+}}, 20
+; CHECK: xor
+; CHECK: andi    {{a[0-9]+}}, {{a[0-9]+}}, 255
+; CHECK: clmul
+; CHECK: andi    {{a[0-9]+}}, {{a[0-9]+}}, 255
+; CHECK: clmul
+; CHECK: srli    {{a[0-9]+}}, {{a[0-9]+}}, 8
+; CHECK-NOT: slli
+; CHECK: xor     a0, {{a[0-9]+}}, {{a[0-9]+}}
 ; CHECK-NEXT: ret
-   ret
\ No newline at end of file
+; Without Zbc the step is selected to shifts and XORs, 28.5 cycles of
+; reciprocal throughput on a SiFive U74 when this was written; the check allows
+; up to 30.9. The Zbc selection above can not be checked that way, the U74
+; scheduling model does not cover Zbc.
+; MCA: Block RThroughput: {{([1-9]|[12][0-9]|30)\.[0-9]}}
+define dso_local zeroext i16 @crcu8(i8 zeroext %data, i16 zeroext %crc) {
+entry:
+  %0 = call i16 @llvm.riscv.crc.petar(i8 %data, i16 %crc)
+  ret i16 %0
+}
+
+; crcu8 as written, fully unrolled by -O2: 29.0 cycles on the U74 when this
+; was written (the check allows 27.0 to 31.9), so without Zbc the step is
+; about as fast as the original loop.
+; MCA-LOOP: Block RThroughput: {{(2[7-9]|3[01])\.[0-9]}}
+define dso_local zeroext i16 @crcu8_original(i8 zeroext %data, i16 zeroext %crc) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i8 [ 0, %entry ], [ %i.next, %loop ]
+  %d = phi i8 [ %data, %entry ], [ %d.next, %loop ]
+  %c = phi i16 [ %crc, %entry ], [ %c.next, %loop ]
+  %c.low = trunc i16 %c to i8
+  %x = xor i8 %d, %c.low
+  %x16 = and i8 %x, 1
+  %d.next = lshr i8 %d, 1
+  %carry = icmp eq i8 %x16, 1
+  %flipped = xor i16 %c, 16386
+  %c.xor = select i1 %carry, i16 %flipped, i16 %c
+  %shr = lshr i16 %c.xor, 1
+  %set = or i16 %shr, -32768
+  %clear = and i16 %shr, 32767
+  %c.next = select i1 %carry, i16 %set, i16 %clear
+  %i.next = add nuw nsw i8 %i, 1
+  %done = icmp eq i8 %i.next, 8
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i16 %c.next
+}
+
+declare i16 @llvm.riscv.crc.petar(i8, i16)
@@ -0,0 +1,72 @@
+; RUN: ../build/bin/opt -S -passes=crc-recognition -crc-lowering=libcall %s 2>&1 | FileCheck %s
+; RUN: ../build/bin/opt -passes=crc-recognition -crc-lowering=libcall -pass-remarks=crc-recognition -disable-output %s 2>&1 | FileCheck %s --check-prefix=REMARK
+
+; With -crc-lowering=libcall a CRC loop over a buffer becomes one call of the
+; CRC runtime, which picks the kernel for the CPU the program runs on.
+; REMARK: remark: {{.*}} CRC loop over a buffer replaced with a call of the CRC runtime
+; REMARK-NOT: CRC loop over a buffer replaced
+
+; CHECK-LABEL: @buffer_crc(
+; CHECK: for.body.preheader:
+; CHECK: [[CRC:%.*]] = zext i16 %crc to i64
+; CHECK-NEXT: [[UPDATE:%.*]] = call i64 @__crc_update(ptr @crc.descriptor.16.0x8005.11.0x0.0x0, i64 [[CRC]], ptr %buf, i64 %len)
+; CHECK-NEXT: [[RESULT:%.*]] = trunc i64 [[UPDATE]] to i16
+; CHECK: for.end.loopexit:
+; CHECK-NEXT: %next.lcssa = phi i16 [ [[RESULT]], %for.body ]
+define dso_local zeroext i16 @buffer_crc(ptr %buf, i64 %len, i16 zeroext %crc) {
+entry:
+  %cmp.not = icmp eq i64 %len, 0
+  br i1 %cmp.not, label %for.end, label %for.body.preheader
+
+for.body.preheader:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ %inc, %for.body ], [ 0, %for.body.preheader ]
+  %crc.cur = phi i16 [ %next, %for.body ], [ %crc, %for.body.preheader ]
+  %arrayidx = getelementptr inbounds i8, ptr %buf, i64 %i
+  %byte = load i8, ptr %arrayidx, align 1
+  %next = call i16 @llvm.riscv.crc.petar(i8 %byte, i16 %crc.cur)
+  %inc = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %inc, %len
+  br i1 %exitcond, label %for.end.loopexit, label %for.body
+
+for.end.loopexit:
+  %next.lcssa = phi i16 [ %next, %for.body ]
+  br label %for.end
+
+for.end:
+  %result = phi i16 [ %crc, %entry ], [ %next.lcssa, %for.end.loopexit ]
+  ret i16 %result
+}
+
+; The loop stores the running CRC, so the buffer is not read in one go.
+; CHECK-LABEL: @buffer_crc_with_store(
+; CHECK-NOT: @__crc_update
+; CHECK: call i16 @llvm.riscv.crc.petar
+define dso_local zeroext i16 @buffer_crc_with_store(ptr %buf, ptr %out, i16 zeroext %crc) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %inc, %for.body ]
+  %crc.cur = phi i16 [ %crc, %entry ], [ %next, %for.body ]
+  %arrayidx = getelementptr inbounds i8, ptr %buf, i64 %i
+  %byte = load i8, ptr %arrayidx, align 1
+  %next = call i16 @llvm.riscv.crc.petar(i8 %byte, i16 %crc.cur)
+  store i16 %next, ptr %out, align 2
+  %inc = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %inc, 64
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %next.lcssa = phi i16 [ %next, %for.body ]
+  ret i16 %next.lcssa
+}
+
+; The runtime reads the descriptor and the buffer, and caches the context of
+; the CRC in memory of its own on the first call.
+; CHECK: declare i64 @__crc_update(ptr, i64, ptr, i64) #[[ATTRS:[0-9]+]]
+; CHECK: attributes #[[ATTRS]] = { {{.*}}nounwind{{.*}}memory(argmem: read, inaccessiblemem: readwrite){{.*}} }
+
+declare i16 @llvm.riscv.crc.petar(i8, i16)
@@ -0,0 +1,81 @@
+; RUN: ../build/bin/opt -S -passes=crc-recognition %s 2>&1 | FileCheck %s
+; RUN: ../build/bin/opt -passes=crc-recognition -pass-remarks=crc-recognition -disable-output %s 2>&1 | FileCheck %s --check-prefix=REMARK
+; RUN: ../build/bin/opt -S -passes=crc-recognition -crc-fuse-steps=false %s 2>&1 | FileCheck %s --check-prefix=UNFUSED
+; RUN: ../build/bin/opt -S -passes=crc-recognition %s | ../build/bin/llc -mtriple=riscv64 -mattr=+zbc -o - | FileCheck %s --check-prefix=ZBC
+
+; crcu16 and crcu32 of CoreMark call crcu8 on the bytes of their argument,
+; least significant byte first. Once crcu8 has been recognized and inlined,
+; the chains of two and four byte steps become one 16 and one 32 bit step.
+; REMARK: remark: {{.*}} 2 CRC steps in crcu16 fused into one step
+; REMARK: remark: {{.*}} 4 CRC steps in crcu32 fused into one step
+; REMARK-NOT: fused into one step
+
+; CHECK-LABEL: @crcu16(
+; CHECK: %crc.wide = call i16 @llvm.riscv.crc.petar.wide.i16(i16 %newval, i16 %crc)
+; CHECK-NEXT: ret i16 %crc.wide
+; UNFUSED-LABEL: @crcu16(
+; UNFUSED-COUNT-2: call i16 @llvm.riscv.crc.petar(
+define dso_local zeroext i16 @crcu16(i16 zeroext %newval, i16 zeroext %crc) {
+entry:
+  %conv = trunc i16 %newval to i8
+  %0 = call i16 @llvm.riscv.crc.petar(i8 %conv, i16 %crc)
+  %shr = lshr i16 %newval, 8
+  %conv1 = trunc i16 %shr to i8
+  %1 = call i16 @llvm.riscv.crc.petar(i8 %conv1, i16 %0)
+  ret i16 %1
+}
+
+; CHECK-LABEL: @crcu32(
+; CHECK: %crc.wide = call i16 @llvm.riscv.crc.petar.wide.i32(i32 %newval, i16 %crc)
+; CHECK-NEXT: ret i16 %crc.wide
+; With Zbc the 32 bit step is one pair of carry-less multiplications.
+; ZBC-LABEL: crcu32:
+; ZBC-COUNT-2: clmul
+; ZBC-NOT: clmul
+; ZBC: ret
+define dso_local zeroext i16 @crcu32(i32 %newval, i16 zeroext %crc) {
+entry:
+  %conv = trunc i32 %newval to i8
+  %0 = call i16 @llvm.riscv.crc.petar(i8 %conv, i16 %crc)
+  %shr = lshr i32 %newval, 8
+  %conv1 = trunc i32 %shr to i8
+  %1 = call i16 @llvm.riscv.crc.petar(i8 %conv1, i16 %0)
+  %shr2 = lshr i32 %newval, 16
+  %conv3 = trunc i32 %shr2 to i8
+  %2 = call i16 @llvm.riscv.crc.petar(i8 %conv3, i16 %1)
+  %shr4 = lshr i32 %newval, 24
+  %conv5 = trunc i32 %shr4 to i8
+  %3 = call i16 @llvm.riscv.crc.petar(i8 %conv5, i16 %2)
+  ret i16 %3
+}
+
+; The CRC after the first byte is stored, so the steps stay apart.
+; CHECK-LABEL: @crc_with_store(
+; CHECK-NOT: @llvm.riscv.crc.petar.wide
+; CHECK: ret i16
+define dso_local zeroext i16 @crc_with_store(i16 zeroext %newval, i16 zeroext %crc, ptr %out) {
+entry:
+  %conv = trunc i16 %newval to i8
+  %0 = call i16 @llvm.riscv.crc.petar(i8 %conv, i16 %crc)
+  store i16 %0, ptr %out, align 2
+  %shr = lshr i16 %newval, 8
+  %conv1 = trunc i16 %shr to i8
+  %1 = call i16 @llvm.riscv.crc.petar(i8 %conv1, i16 %0)
+  ret i16 %1
+}
+
+; The high byte goes first, which is a different CRC.
+; CHECK-LABEL: @crc_swapped(
+; CHECK-NOT: @llvm.riscv.crc.petar.wide
+; CHECK: ret i16
+define dso_local zeroext i16 @crc_swapped(i16 zeroext %newval, i16 zeroext %crc) {
+entry:
+  %shr = lshr i16 %newval, 8
+  %conv = trunc i16 %shr to i8
+  %0 = call i16 @llvm.riscv.crc.petar(i8 %conv, i16 %crc)
+  %conv1 = trunc i16 %newval to i8
+  %1 = call i16 @llvm.riscv.crc.petar(i8 %conv1, i16 %0)
+  ret i16 %1
+}
+
+declare i16 @llvm.riscv.crc.petar(i8, i16)
@@ -0,0 +1,207 @@
+; RUN: ../build/bin/opt -S -passes=crc-table-init %s 2>&1 | FileCheck %s
+; RUN: ../build/bin/opt -passes=crc-table-init -pass-remarks=crc-recognition -disable-output %s 2>&1 | FileCheck %s --check-prefix=REMARK
+; RUN: ../build/bin/opt -S -mtriple=riscv64 -passes='crc-table-init,function(crc-recognition),crc-table-merge' -pass-remarks=crc-recognition %s 2>&1 | FileCheck %s --check-prefix=STEP
+; RUN: ../build/bin/opt -S -mtriple=x86_64 -passes='crc-table-init,function(crc-recognition),crc-table-merge' %s 2>&1 | FileCheck %s --check-prefix=X86
+
+; The CRC-16/ARC table filled by make_crc_table on first use becomes the
+; initializer of crc_table, and the lazy initialization disappears from the
+; hot path.
+; REMARK: remark: {{.*}} CRC table initialization make_crc_table evaluated at compile time
+; REMARK: remark: {{.*}} CRC table initialization make_crc32_table evaluated at compile time
+; CHECK: @crc_table = internal constant [256 x i16] [i16 0, i16 -16191, i16 -15999, {{.*}}], align 16
+; CHECK: @table_ready = internal constant i32 1
+; CHECK: @crc32_table = internal constant [256 x i32] [i32 0, i32 1996959894, i32 -301047508, {{.*}}], align 16
+; CHECK: @crc32_ready = internal constant i32 1
+; CHECK-NOT: @make_crc_table
+
+; CHECK-LABEL: @crc16_update(
+; CHECK-NOT: call
+; CHECK-NOT: br i1
+; CHECK: getelementptr inbounds [256 x i16], ptr @crc_table
+
+; Once the lookup is recognized as a CRC step the table is not needed at all.
+; STEP: remark: {{.*}} CRC table lookup in crc_table replaced with a CRC step
+; STEP-NOT: @crc_table
+; STEP-LABEL: @crc16_update(
+; STEP: %crc.step = call i16 @llvm.riscv.crc.petar(i8 %data, i16 %crc)
+; STEP-NEXT: ret i16 %crc.step
+
+; Only the RISC-V backend selects CRC steps, other targets keep the lookup.
+; X86: @crc_table = internal constant [256 x i16]
+; X86-LABEL: @crc16_update(
+; X86-NOT: @llvm.riscv.crc.petar
+; X86: getelementptr inbounds [256 x i16], ptr @crc_table
+; X86-NOT: @llvm.riscv.crc.petar
+
+@crc_table = internal global [256 x i16] zeroinitializer, align 16
+@table_ready = internal global i32 0, align 4
+
+; static void make_crc_table(void) {
+;   for (int n = 0; n < 256; n++) {
+;     unsigned short c = n;
+;     for (int k = 0; k < 8; k++)
+;       c = c & 1 ? 0xa001 ^ (c >> 1) : c >> 1;
+;     crc_table[n] = c;
+;   }
+;   table_ready = 1;
+; }
+define internal void @make_crc_table() {
+entry:
+  br label %outer
+
+outer:
+  %n = phi i32 [ 0, %entry ], [ %n.next, %outer.latch ]
+  %c.init = trunc i32 %n to i16
+  br label %inner
+
+inner:
+  %k = phi i32 [ 0, %outer ], [ %k.next, %inner ]
+  %c = phi i16 [ %c.init, %outer ], [ %c.next, %inner ]
+  %bit = and i16 %c, 1
+  %odd = icmp ne i16 %bit, 0
+  %shr = lshr i16 %c, 1
+  %xored = xor i16 %shr, -24575
+  %c.next = select i1 %odd, i16 %xored, i16 %shr
+  %k.next = add nuw nsw i32 %k, 1
+  %k.done = icmp eq i32 %k.next, 8
+  br i1 %k.done, label %outer.latch, label %inner
+
+outer.latch:
+  %idx = zext i32 %n to i64
+  %slot = getelementptr inbounds [256 x i16], ptr @crc_table, i64 0, i64 %idx
+  store i16 %c.next, ptr %slot, align 2
+  %n.next = add nuw nsw i32 %n, 1
+  %n.done = icmp eq i32 %n.next, 256
+  br i1 %n.done, label %exit, label %outer
+
+exit:
+  store i32 1, ptr @table_ready, align 4
+  ret void
+}
+
+; unsigned short crc16_update(unsigned char data, unsigned short crc) {
+;   if (!table_ready)
+;     make_crc_table();
+;   return (crc >> 8) ^ crc_table[(crc ^ data) & 0xff];
+; }
+define dso_local zeroext i16 @crc16_update(i8 zeroext %data, i16 zeroext %crc) {
+entry:
+  %ready = load i32, ptr @table_ready, align 4
+  %tobool = icmp eq i32 %ready, 0
+  br i1 %tobool, label %init, label %lookup
+
+init:
+  call void @make_crc_table()
+  br label %lookup
+
+lookup:
+  %low = trunc i16 %crc to i8
+  %x = xor i8 %low, %data
+  %idx = zext i8 %x to i64
+  %arrayidx = getelementptr inbounds [256 x i16], ptr @crc_table, i64 0, i64 %idx
+  %entry.val = load i16, ptr %arrayidx, align 2
+  %shr = lshr i16 %crc, 8
+  %next = xor i16 %shr, %entry.val
+  ret i16 %next
+}
+
+; A function that reads two lazily initialized tables is rewritten once per
+; initialization function; the second one has to see the rewritten CFG.
+; CHECK-LABEL: @crc16_crc32_update(
+; CHECK-NOT: call
+; CHECK-NOT: br i1
+; CHECK: getelementptr inbounds [256 x i16], ptr @crc_table
+; CHECK: getelementptr inbounds [256 x i32], ptr @crc32_table
+
+@crc32_table = internal global [256 x i32] zeroinitializer, align 16
+@crc32_ready = internal global i32 0, align 4
+
+; static void make_crc32_table(void) {
+;   for (int n = 0; n < 256; n++) {
+;     unsigned c = n;
+;     for (int k = 0; k < 8; k++)
+;       c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+;     crc32_table[n] = c;
+;   }
+;   crc32_ready = 1;
+; }
+define internal void @make_crc32_table() {
+entry:
+  br label %outer
+
+outer:
+  %n = phi i32 [ 0, %entry ], [ %n.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %k = phi i32 [ 0, %outer ], [ %k.next, %inner ]
+  %c = phi i32 [ %n, %outer ], [ %c.next, %inner ]
+  %bit = and i32 %c, 1
+  %odd = icmp ne i32 %bit, 0
+  %shr = lshr i32 %c, 1
+  %xored = xor i32 %shr, -306674912
+  %c.next = select i1 %odd, i32 %xored, i32 %shr
+  %k.next = add nuw nsw i32 %k, 1
+  %k.done = icmp eq i32 %k.next, 8
+  br i1 %k.done, label %outer.latch, label %inner
+
+outer.latch:
+  %idx = zext i32 %n to i64
+  %slot = getelementptr inbounds [256 x i32], ptr @crc32_table, i64 0, i64 %idx
+  store i32 %c.next, ptr %slot, align 4
+  %n.next = add nuw nsw i32 %n, 1
+  %n.done = icmp eq i32 %n.next, 256
+  br i1 %n.done, label %exit, label %outer
+
+exit:
+  store i32 1, ptr @crc32_ready, align 4
+  ret void
+}
+
+; unsigned crc16_crc32_update(unsigned char data, unsigned short *crc16,
+;                             unsigned crc32) {
+;   if (!table_ready)
+;     make_crc_table();
+;   if (!crc32_ready)
+;     make_crc32_table();
+;   *crc16 = (*crc16 >> 8) ^ crc_table[(*crc16 ^ data) & 0xff];
+;   return (crc32 >> 8) ^ crc32_table[(crc32 ^ data) & 0xff];
+; }
+define dso_local i32 @crc16_crc32_update(i8 zeroext %data, ptr %crc16, i32 %crc32) {
+entry:
+  %ready = load i32, ptr @table_ready, align 4
+  %tobool = icmp eq i32 %ready, 0
+  br i1 %tobool, label %init, label %check32
+
+init:
+  call void @make_crc_table()
+  br label %check32
+
+check32:
+  %ready32 = load i32, ptr @crc32_ready, align 4
+  %tobool32 = icmp eq i32 %ready32, 0
+  br i1 %tobool32, label %init32, label %lookup
+
+init32:
+  call void @make_crc32_table()
+  br label %lookup
+
+lookup:
+  %crc = load i16, ptr %crc16, align 2
+  %low = trunc i16 %crc to i8
+  %x = xor i8 %low, %data
+  %idx = zext i8 %x to i64
+  %arrayidx = getelementptr inbounds [256 x i16], ptr @crc_table, i64 0, i64 %idx
+  %entry.val = load i16, ptr %arrayidx, align 2
+  %shr = lshr i16 %crc, 8
+  %next = xor i16 %shr, %entry.val
+  store i16 %next, ptr %crc16, align 2
+  %low32 = trunc i32 %crc32 to i8
+  %x32 = xor i8 %low32, %data
+  %idx32 = zext i8 %x32 to i64
+  %arrayidx32 = getelementptr inbounds [256 x i32], ptr @crc32_table, i64 0, i64 %idx32
+  %entry.val32 = load i32, ptr %arrayidx32, align 4
+  %shr32 = lshr i32 %crc32, 8
+  %next32 = xor i32 %shr32, %entry.val32
+  ret i32 %next32
+}
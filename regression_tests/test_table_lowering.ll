@@ -0,0 +1,53 @@
+; RUN: ../build/bin/opt -S -passes=crc-recognition -crc-lowering=table %s 2>&1 | FileCheck %s --check-prefix=LOWER
+; RUN: ../build/bin/opt -S -passes=crc-table-merge %s 2>&1 | FileCheck %s --check-prefix=MERGE
+; RUN: ../build/bin/opt -S -passes=crc-recognition -crc-lowering=table %s -o - | ../build/bin/llc -mtriple=x86_64 -o - | ../build/bin/llvm-mca -mtriple=x86_64 -mcpu=skylake - 2>&1 | FileCheck %s --check-prefix=MCA
+
+; With -crc-lowering=table every CRC step becomes a lookup in one table per
+; CRC, which is linkonce_odr in its own comdat and aligned to a cache line, so
+; the linker keeps one copy for all translation units.
+; LOWER: $crc.table.16.0x8005.1.i16 = comdat any
+; LOWER: @crc.table.16.0x8005.1.i16 = linkonce_odr hidden unnamed_addr constant [256 x i16] [i16 0, i16 -16191, i16 -15999, {{.*}}], comdat, align 64
+
+; LOWER-LABEL: @crcu8(
+; LOWER: [[CRC:%.*]] = trunc i16 %crc to i8
+; LOWER-NEXT: [[INDEX:%.*]] = xor i8 [[CRC]], %data
+; LOWER-NEXT: [[SHIFTED:%.*]] = lshr i16 %crc, 8
+; LOWER-NEXT: [[IDX64:%.*]] = zext i8 [[INDEX]] to i64
+; LOWER-NEXT: [[ENTRY:%.*]] = getelementptr inbounds [256 x i16], ptr @crc.table.16.0x8005.1.i16, i64 0, i64 [[IDX64]]
+; LOWER-NEXT: %crc.entry = load i16, ptr [[ENTRY]], align 2
+; LOWER-NEXT: %crc.next = xor i16 [[SHIFTED]], %crc.entry
+; LOWER-NEXT: ret i16 %crc.next
+
+; Lowered to lookups, both steps of this file together stay below 5 cycles
+; of reciprocal throughput on Skylake.
+; MCA: Block RThroughput: {{[0-4]\.[0-9]}}
+define dso_local zeroext i16 @crcu8(i8 zeroext %data, i16 zeroext %crc) {
+entry:
+  %0 = call i16 @llvm.riscv.crc.petar(i8 %data, i16 %crc)
+  ret i16 %0
+}
+
+; The CRC-16/ARC table of a Sarwate implementation in the program is the
+; same table, so it is replaced with the shared one.
+; MERGE-NOT: @crc16_table =
+; MERGE: @exported_table = dso_local constant [256 x i16]
+; MERGE-LABEL: @sarwate_step(
+; MERGE: getelementptr inbounds [256 x i16], ptr @crc.table.16.0x8005.1.i16, i64 0, i64 %idx
+@crc16_table = internal unnamed_addr constant [256 x i16] [i16 0, i16 -16191, i16 -15999, i16 320, i16 -15615, i16 960, i16 640, i16 -15807, i16 -14847, i16 1728, i16 1920, i16 -14527, i16 1280, i16 -14911, i16 -15231, i16 1088, i16 -13311, i16 3264, i16 3456, i16 -12991, i16 3840, i16 -12351, i16 -12671, i16 3648, i16 2560, i16 -13631, i16 -13439, i16 2880, i16 -14079, i16 2496, i16 2176, i16 -14271, i16 -10239, i16 6336, i16 6528, i16 -9919, i16 6912, i16 -9279, i16 -9599, i16 6720, i16 7680, i16 -8511, i16 -8319, i16 8000, i16 -8959, i16 7616, i16 7296, i16 -9151, i16 5120, i16 -11071, i16 -10879, i16 5440, i16 -10495, i16 6080, i16 5760, i16 -10687, i16 -11775, i16 4800, i16 4992, i16 -11455, i16 4352, i16 -11839, i16 -12159, i16 4160, i16 -4095, i16 12480, i16 12672, i16 -3775, i16 13056, i16 -3135, i16 -3455, i16 12864, i16 13824, i16 -2367, i16 -2175, i16 14144, i16 -2815, i16 13760, i16 13440, i16 -3007, i16 15360, i16 -831, i16 -639, i16 15680, i16 -255, i16 16320, i16 16000, i16 -447, i16 -1535, i16 15040, i16 15232, i16 -1215, i16 14592, i16 -1599, i16 -1919, i16 14400, i16 10240, i16 -5951, i16 -5759, i16 10560, i16 -5375, i16 11200, i16 10880, i16 -5567, i16 -4607, i16 11968, i16 12160, i16 -4287, i16 11520, i16 -4671, i16 -4991, i16 11328, i16 -7167, i16 9408, i16 9600, i16 -6847, i16 9984, i16 -6207, i16 -6527, i16 9792, i16 8704, i16 -7487, i16 -7295, i16 9024, i16 -7935, i16 8640, i16 8320, i16 -8127, i16 -24575, i16 24768, i16 24960, i16 -24255, i16 25344, i16 -23615, i16 -23935, i16 25152, i16 26112, i16 -22847, i16 -22655, i16 26432, i16 -23295, i16 26048, i16 25728, i16 -23487, i16 27648, i16 -21311, i16 -21119, i16 27968, i16 -20735, i16 28608, i16 28288, i16 -20927, i16 -22015, i16 27328, i16 27520, i16 -21695, i16 26880, i16 -22079, i16 -22399, i16 26688, i16 30720, i16 -18239, i16 -18047, i16 31040, i16 -17663, i16 31680, i16 31360, i16 -17855, i16 -16895, i16 32448, i16 32640, i16 -16575, i16 32000, i16 -16959, i16 -17279, i16 31808, i16 -19455, i16 29888, i16 30080, i16 -19135, i16 30464, i16 -18495, i16 -18815, i16 30272, i16 29184, i16 -19775, i16 -19583, i16 29504, i16 -20223, i16 29120, i16 28800, i16 -20415, i16 20480, i16 -28479, i16 -28287, i16 20800, i16 -27903, i16 21440, i16 21120, i16 -28095, i16 -27135, i16 22208, i16 22400, i16 -26815, i16 21760, i16 -27199, i16 -27519, i16 21568, i16 -25599, i16 23744, i16 23936, i16 -25279, i16 24320, i16 -24639, i16 -24959, i16 24128, i16 23040, i16 -25919, i16 -25727, i16 23360, i16 -26367, i16 22976, i16 22656, i16 -26559, i16 -30719, i16 18624, i16 18816, i16 -30399, i16 19200, i16 -29759, i16 -30079, i16 19008, i16 19968, i16 -28991, i16 -28799, i16 20288, i16 -29439, i16 19904, i16 19584, i16 -29631, i16 17408, i16 -31551, i16 -31359, i16 17728, i16 -30975, i16 18368, i16 18048, i16 -31167, i16 -32255, i16 17088, i16 17280, i16 -31935, i16 16640, i16 -32319, i16 -32639, i16 16448], align 16
+
+define dso_local zeroext i16 @sarwate_step(i8 zeroext %data, i16 zeroext %crc) {
+entry:
+  %low = trunc i16 %crc to i8
+  %x = xor i8 %low, %data
+  %idx = zext i8 %x to i64
+  %arrayidx = getelementptr inbounds [256 x i16], ptr @crc16_table, i64 0, i64 %idx
+  %entry.val = load i16, ptr %arrayidx, align 2
+  %shr = lshr i16 %crc, 8
+  %next = xor i16 %shr, %entry.val
+  ret i16 %next
+}
+
+; A table that other modules can refer to is left alone.
+@exported_table = dso_local constant [256 x i16] [i16 0, i16 -16191, i16 -15999, i16 320, i16 -15615, i16 960, i16 640, i16 -15807, i16 -14847, i16 1728, i16 1920, i16 -14527, i16 1280, i16 -14911, i16 -15231, i16 1088, i16 -13311, i16 3264, i16 3456, i16 -12991, i16 3840, i16 -12351, i16 -12671, i16 3648, i16 2560, i16 -13631, i16 -13439, i16 2880, i16 -14079, i16 2496, i16 2176, i16 -14271, i16 -10239, i16 6336, i16 6528, i16 -9919, i16 6912, i16 -9279, i16 -9599, i16 6720, i16 7680, i16 -8511, i16 -8319, i16 8000, i16 -8959, i16 7616, i16 7296, i16 -9151, i16 5120, i16 -11071, i16 -10879, i16 5440, i16 -10495, i16 6080, i16 5760, i16 -10687, i16 -11775, i16 4800, i16 4992, i16 -11455, i16 4352, i16 -11839, i16 -12159, i16 4160, i16 -4095, i16 12480, i16 12672, i16 -3775, i16 13056, i16 -3135, i16 -3455, i16 12864, i16 13824, i16 -2367, i16 -2175, i16 14144, i16 -2815, i16 13760, i16 13440, i16 -3007, i16 15360, i16 -831, i16 -639, i16 15680, i16 -255, i16 16320, i16 16000, i16 -447, i16 -1535, i16 15040, i16 15232, i16 -1215, i16 14592, i16 -1599, i16 -1919, i16 14400, i16 10240, i16 -5951, i16 -5759, i16 10560, i16 -5375, i16 11200, i16 10880, i16 -5567, i16 -4607, i16 11968, i16 12160, i16 -4287, i16 11520, i16 -4671, i16 -4991, i16 11328, i16 -7167, i16 9408, i16 9600, i16 -6847, i16 9984, i16 -6207, i16 -6527, i16 9792, i16 8704, i16 -7487, i16 -7295, i16 9024, i16 -7935, i16 8640, i16 8320, i16 -8127, i16 -24575, i16 24768, i16 24960, i16 -24255, i16 25344, i16 -23615, i16 -23935, i16 25152, i16 26112, i16 -22847, i16 -22655, i16 26432, i16 -23295, i16 26048, i16 25728, i16 -23487, i16 27648, i16 -21311, i16 -21119, i16 27968, i16 -20735, i16 28608, i16 28288, i16 -20927, i16 -22015, i16 27328, i16 27520, i16 -21695, i16 26880, i16 -22079, i16 -22399, i16 26688, i16 30720, i16 -18239, i16 -18047, i16 31040, i16 -17663, i16 31680, i16 31360, i16 -17855, i16 -16895, i16 32448, i16 32640, i16 -16575, i16 32000, i16 -16959, i16 -17279, i16 31808, i16 -19455, i16 29888, i16 30080, i16 -19135, i16 30464, i16 -18495, i16 -18815, i16 30272, i16 29184, i16 -19775, i16 -19583, i16 29504, i16 -20223, i16 29120, i16 28800, i16 -20415, i16 20480, i16 -28479, i16 -28287, i16 20800, i16 -27903, i16 21440, i16 21120, i16 -28095, i16 -27135, i16 22208, i16 22400, i16 -26815, i16 21760, i16 -27199, i16 -27519, i16 21568, i16 -25599, i16 23744, i16 23936, i16 -25279, i16 24320, i16 -24639, i16 -24959, i16 24128, i16 23040, i16 -25919, i16 -25727, i16 23360, i16 -26367, i16 22976, i16 22656, i16 -26559, i16 -30719, i16 18624, i16 18816, i16 -30399, i16 19200, i16 -29759, i16 -30079, i16 19008, i16 19968, i16 -28991, i16 -28799, i16 20288, i16 -29439, i16 19904, i16 19584, i16 -29631, i16 17408, i16 -31551, i16 -31359, i16 17728, i16 -30975, i16 18368, i16 18048, i16 -31167, i16 -32255, i16 17088, i16 17280, i16 -31935, i16 16640, i16 -32319, i16 -32639, i16 16448], align 16
+
+declare i16 @llvm.riscv.crc.petar(i8, i16)
@@ -0,0 +1,54 @@
+; RUN: ../build/bin/opt -S -passes='function(crc-recognition),crc-vector-variants' %s 2>&1 | FileCheck %s
+; RUN: ../build/bin/opt -S -mtriple=x86_64 -passes='function(crc-recognition),crc-vector-variants' %s 2>&1 | FileCheck %s --check-prefix=X86
+
+; Calls of a recognized crcu8 get vector variants for LoopVectorize. With
+; V the fixed-length vector registers hold 16 CRC-16 lanes, so all three
+; vectorization factors are offered. Only RISC-V selects the vector CRC
+; intrinsic the variants are made of, other targets keep the scalar calls.
+; X86-NOT: @llvm.compiler.used
+; X86-NOT: vector-function-abi-variant
+; X86-NOT: define {{.*}} @__crcu8_v
+
+target triple = "riscv64-unknown-linux-gnu"
+
+; CHECK: @llvm.compiler.used = appending global [3 x ptr] [ptr @__crcu8_v4, ptr @__crcu8_v8, ptr @__crcu8_v16]
+
+; The wrapper is marked from its own run, its calls by crc-vector-variants.
+; CHECK: define dso_local zeroext i16 @crcu8(i8 zeroext %0, i16 zeroext %1) #[[WRAPPER:[0-9]+]]
+define dso_local zeroext i16 @crcu8(i8 zeroext %0, i16 zeroext %1) {
+  %3 = call i16 @llvm.riscv.crc.petar(i8 %0, i16 %1)
+  ret i16 %3
+}
+
+; CHECK-LABEL: @crc_rows(
+; CHECK: call zeroext i16 @crcu8(i8 zeroext %byte, i16 zeroext %crc) #[[VARIANTS:[0-9]+]]
+define dso_local void @crc_rows(ptr noalias %data, ptr noalias %crcs, i64 %n) #0 {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %inc, %for.body ]
+  %data.i = getelementptr inbounds i8, ptr %data, i64 %i
+  %byte = load i8, ptr %data.i, align 1
+  %crcs.i = getelementptr inbounds i16, ptr %crcs, i64 %i
+  %crc = load i16, ptr %crcs.i, align 2
+  %next = call zeroext i16 @crcu8(i8 zeroext %byte, i16 zeroext %crc)
+  store i16 %next, ptr %crcs.i, align 2
+  %inc = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %inc, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; CHECK: define linkonce_odr hidden <4 x i16> @__crcu8_v4(<4 x i8> %0, <4 x i16> %1)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call <4 x i16> @llvm.riscv.crc.petar.vector.v4i16(<4 x i8> %0, <4 x i16> %1)
+; CHECK: define linkonce_odr hidden <16 x i16> @__crcu8_v16(<16 x i8> %0, <16 x i16> %1)
+; CHECK: attributes #[[WRAPPER]] = { nounwind willreturn memory(none) "crc-step-wrapper" }
+; CHECK: attributes #[[VARIANTS]] = { nounwind willreturn memory(none) "vector-function-abi-variant"="_ZGV_LLVM_N4vv_crcu8(__crcu8_v4),_ZGV_LLVM_N8vv_crcu8(__crcu8_v8),_ZGV_LLVM_N16vv_crcu8(__crcu8_v16)" }
+
+declare i16 @llvm.riscv.crc.petar(i8, i16)
+
+attributes #0 = { "target-features"="+64bit,+v" }
@@ -0,0 +1,95 @@
+; RUN: ../build/bin/opt -S -passes=crc-recognition -crc-zeros %s 2>&1 | FileCheck %s
+; RUN: ../build/bin/opt -passes=crc-recognition -crc-zeros -pass-remarks=crc-recognition -disable-output %s 2>&1 | FileCheck %s --check-prefix=REMARK
+
+; CRC updates over runs of zero bytes are computed as crc * x^(8n) mod P.
+; REMARK: remark: {{.*}} CRC loop over zero bytes replaced with x^(8n) mod P
+
+; 1000 zero bytes into CRC-16/ARC starting from 0xffff give 0x0b54.
+; CHECK-LABEL: @padding_crc(
+; CHECK: for.end:
+; CHECK-NEXT: %next.lcssa = phi i16 [ 2900, %for.body ]
+define dso_local zeroext i16 @padding_crc() {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i32 [ 0, %entry ], [ %inc, %for.body ]
+  %crc = phi i16 [ -1, %entry ], [ %next, %for.body ]
+  %next = call i16 @llvm.riscv.crc.petar(i8 0, i16 %crc)
+  %inc = add nuw nsw i32 %i, 1
+  %exitcond = icmp eq i32 %inc, 1000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %next.lcssa = phi i16 [ %next, %for.body ]
+  ret i16 %next.lcssa
+}
+
+; The block is zeroed by memset and nothing writes to it before the loop, so
+; the CRC over its first n bytes is one call of the runtime.
+; CHECK-LABEL: @zeroed_block_crc(
+; CHECK: for.body.preheader:
+; CHECK: [[CRC:%.*]] = zext i16 %crc to i64
+; CHECK-NEXT: [[ZEROS:%.*]] = call i64 @__crc_update_zeros(ptr @crc.descriptor.16.0x8005.11.0x0.0x0, i64 [[CRC]], i64 %n)
+; CHECK-NEXT: [[RESULT:%.*]] = trunc i64 [[ZEROS]] to i16
+; CHECK: for.end.loopexit:
+; CHECK-NEXT: %next.lcssa = phi i16 [ [[RESULT]], %for.body ]
+define dso_local zeroext i16 @zeroed_block_crc(i16 zeroext %crc, i64 %len) {
+entry:
+  %block = alloca [4096 x i8], align 16
+  call void @llvm.memset.p0.i64(ptr align 16 %block, i8 0, i64 4096, i1 false)
+  %n = and i64 %len, 4095
+  %cmp.not = icmp eq i64 %n, 0
+  br i1 %cmp.not, label %for.end, label %for.body.preheader
+
+for.body.preheader:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ %inc, %for.body ], [ 0, %for.body.preheader ]
+  %crc.cur = phi i16 [ %next, %for.body ], [ %crc, %for.body.preheader ]
+  %arrayidx = getelementptr inbounds i8, ptr %block, i64 %i
+  %byte = load i8, ptr %arrayidx, align 1
+  %next = call i16 @llvm.riscv.crc.petar(i8 %byte, i16 %crc.cur)
+  %inc = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %inc, %n
+  br i1 %exitcond, label %for.end.loopexit, label %for.body
+
+for.end.loopexit:
+  %next.lcssa = phi i16 [ %next, %for.body ]
+  br label %for.end
+
+for.end:
+  %result = phi i16 [ %crc, %entry ], [ %next.lcssa, %for.end.loopexit ]
+  ret i16 %result
+}
+
+; The block is not known to be zero after it has been passed to @fill_header.
+; CHECK-LABEL: @filled_block_crc(
+; CHECK-NOT: @__crc_update_zeros
+; CHECK: ret i16
+define dso_local zeroext i16 @filled_block_crc(i16 zeroext %crc) {
+entry:
+  %block = alloca [64 x i8], align 16
+  call void @llvm.memset.p0.i64(ptr align 16 %block, i8 0, i64 64, i1 false)
+  call void @fill_header(ptr %block)
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %inc, %for.body ]
+  %crc.cur = phi i16 [ %crc, %entry ], [ %next, %for.body ]
+  %arrayidx = getelementptr inbounds i8, ptr %block, i64 %i
+  %byte = load i8, ptr %arrayidx, align 1
+  %next = call i16 @llvm.riscv.crc.petar(i8 %byte, i16 %crc.cur)
+  %inc = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %inc, 64
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %next.lcssa = phi i16 [ %next, %for.body ]
+  ret i16 %next.lcssa
+}
+
+declare void @fill_header(ptr)
+declare void @llvm.memset.p0.i64(ptr, i8, i64, i1)
+declare i16 @llvm.riscv.crc.petar(i8, i16)
@@ -0,0 +1,133 @@
+#!/bin/bash
+
+# Build and run the CRC benchmark of evaluation/time_measurement for every
+# combination of
+#   implementation: unoptimized, optimized, pass-ir (unoptimized + IR level
+#                   CRC optimization), pass-intrinsic (unoptimized + intrinsic
+#                   based CRC optimization, RISC-V with Zbc only)
+#   optimization:   -O0, -O2, -O3
+#   target:         x86-64 (native), riscv64 (under qemu)
+# and write the results to <output>.csv and <output>.json. The binaries and
+# the build logs of the variants are kept in <output>.build. A variant whose
+# checksum differs from the other variants of its target is reported as a
+# checksum mismatch. Where the harness could read the hardware performance
+# counters, their medians per call are reported too (empty/null otherwise).
+#
+# Usage: ./benchmark_matrix.sh [output prefix] [repetitions]
+#
+# Environment:
+#   LLVM_BIN       directory with clang and opt built with the CRC passes
+#                  (default: ../build/bin, like the regression tests)
+#   TARGETS        targets to run (default: "x86-64 riscv64")
+#   RISCV_SYSROOT  sysroot of the riscv64 toolchain (default: /usr/riscv64-linux-gnu)
+#   QEMU_RISCV     qemu user mode emulator (default: qemu-riscv64)
+#   RISCV_CPU      qemu CPU model with the Zbc extension (default: rv64,zbc=true)
+#   INPUTS         inputs file (default: evaluation/time_measurement/inputs.txt)
+
+OUTPUT=${1:-benchmark_results}
+REPETITIONS=${2:-15}
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+SRC="$ROOT/evaluation/time_measurement"
+LLVM_BIN=${LLVM_BIN:-$ROOT/../build/bin}
+TARGETS=${TARGETS:-"x86-64 riscv64"}
+INPUTS=${INPUTS:-$SRC/inputs.txt}
+. "$ROOT/scripts/crc_build_common.sh"
+
+# Binaries and build logs are kept next to the report
+WORK="$OUTPUT.build"
+mkdir -p "$WORK" || exit 1
+
+# Build one variant, print nothing on success and the reason on failure
+build_variant() {
+    local impl=$1 opt=$2 target=$3 out=$4
+    local flags
+    flags="$(target_flags "$target")"
+
+    case $impl in
+        unoptimized)
+            "$LLVM_BIN/clang" $flags $opt "$SRC/unoptimized_crc.c" -o "$out" -lm 2>"$out.log" ;;
+        optimized)
+            "$LLVM_BIN/clang" $flags $opt "$SRC/optimized_crc.c" -o "$out" -lm 2>"$out.log" ;;
+        pass-ir|pass-intrinsic)
+            if [ "$impl" = pass-intrinsic ] && [ "$target" != riscv64 ]; then
+                echo "intrinsic lowering is RISC-V only"
+                return 1
+            fi
+            local pass_flag=-crc-opt
+            [ "$impl" = pass-intrinsic ] && pass_flag=-crc-opt-intrinsic
+            # Same flow as scripts/test_equivalence.sh: unoptimized IR, then
+            # the CRC pass, then the requested optimization level.
+            "$LLVM_BIN/clang" $flags -O0 -Xclang -disable-O0-optnone -S -emit-llvm \
+                "$SRC/unoptimized_crc.c" -o "$out.ll" 2>"$out.log" &&
+            "$LLVM_BIN/opt" -S $pass_flag -passes=crc-recognition "$out.ll" \
+                -o "$out.crc.ll" 2>>"$out.log" &&
+            "$LLVM_BIN/clang" $flags $opt "$out.crc.ll" -o "$out" -lm 2>>"$out.log" ;;
+    esac || { echo "build failed, see $out.log"; return 1; }
+}
+
+echo "implementation,optimization,target,status,ns_call_min,ns_call_median,ns_call_stddev,cycles_byte_min,cycles_byte_median,cycles_byte_stddev,checksum,hw_cycles_call,instructions_call,branches_call,branch_misses_call,l1d_misses_call" > "$OUTPUT.csv"
+json_rows=()
+
+for target in $TARGETS; do
+    # Every variant has to compute the checksum of the first one that runs
+    reference_checksum=""
+    for impl in unoptimized optimized pass-ir pass-intrinsic; do
+        for opt in -O0 -O2 -O3; do
+            bin="$WORK/$impl$opt-$target"
+            status=ok
+            ns=",,"; cycles=",,"; checksum=""; counters=",,,,"
+            if reason=$(build_variant "$impl" "$opt" "$target" "$bin"); then
+                result=$($(target_runner "$target") "$bin" "$INPUTS" "$REPETITIONS" 2>&1)
+                if [ $? -ne 0 ]; then
+                    status="run failed"
+                else
+                    ns=$(echo "$result" | awk '/ns\/call/ { print $3 "," $5 "," $7 }')
+                    cycles=$(echo "$result" | awk '/cycles\/byte/ { print $3 "," $5 "," $7 }')
+                    checksum=$(echo "$result" | awk '/checksum/ { print $2 }')
+                    [ -z "$cycles" ] && cycles=",,"
+                    counters=$(echo "$result" | awk '
+                        $1 ~ /\/call$/ && $1 != "ns/call" { median[$1] = $5 }
+                        END { printf "%s,%s,%s,%s,%s", median["cycles/call"], median["instr/call"],
+                              median["branches/call"], median["br-misses/call"], median["l1d-miss/call"] }')
+                    [ -z "$reference_checksum" ] && reference_checksum=$checksum
+                    [ "$checksum" != "$reference_checksum" ] && status="checksum mismatch"
+                fi
+            else
+                status=$reason
+            fi
+
+            if [ "$status" = ok ]; then
+                echo "$impl $opt $target: ns/call min,median,stddev $ns"
+            else
+                echo "$impl $opt $target: $status"
+            fi
+            echo "$impl,$opt,$target,\"$status\",$ns,$cycles,$checksum,$counters" >> "$OUTPUT.csv"
+
+            IFS=, read -r ns_min ns_median ns_stddev <<< "$ns"
+            IFS=, read -r cy_min cy_median cy_stddev <<< "$cycles"
+            IFS=, read -r hw_cycles instructions branches branch_misses l1d_misses <<< "$counters"
+            json_rows+=("$(printf '  {"implementation": "%s", "optimization": "%s", "target": "%s", "status": "%s", "ns_per_call": {"min": %s, "median": %s, "stddev": %s}, "cycles_per_byte": {"min": %s, "median": %s, "stddev": %s}, "checksum": %s, "counters_per_call": {"cycles": %s, "instructions": %s, "branches": %s, "branch_misses": %s, "l1d_misses": %s}}' \
+                "$impl" "$opt" "$target" "$status" \
+                "${ns_min:-null}" "${ns_median:-null}" "${ns_stddev:-null}" \
+                "${cy_min:-null}" "${cy_median:-null}" "${cy_stddev:-null}" \
+                "${checksum:-null}" \
+                "${hw_cycles:-null}" "${instructions:-null}" "${branches:-null}" \
+                "${branch_misses:-null}" "${l1d_misses:-null}")")
+        done
+    done
+done
+
+{
+    echo "["
+    for ((i = 0; i < ${#json_rows[@]}; i++)); do
+        if [ $i -lt $((${#json_rows[@]} - 1)) ]; then
+            echo "${json_rows[$i]},"
+        else
+            echo "${json_rows[$i]}"
+        fi
+    done
+    echo "]"
+} > "$OUTPUT.json"
+
+echo "Results written to $OUTPUT.csv and $OUTPUT.json"
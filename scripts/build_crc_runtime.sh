@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# Build the CRC runtime (implementations/crc-runtime) as a static library that
+# programs compiled with -crc-lowering=libcall, -crc-zeros or -crc-batch are
+# linked against.
+#
+# Usage: ./build_crc_runtime.sh [compiler] [output directory]
+# e.g.   ./build_crc_runtime.sh riscv64-linux-gnu-gcc build-riscv
+
+CC=${1:-cc}
+OUT=${2:-build-crc-runtime}
+SRC="$(dirname "$0")/../implementations/crc-runtime"
+
+mkdir -p "$OUT" || exit 1
+
+# The kernels for optional instruction set extensions are compiled for the
+# baseline target and enabled per function, the dispatcher only calls them on
+# CPUs that have the extension.
+objects=()
+for file in crc_bitwise.c crc_bitsliced.c crc_zeros.c crc_slicing.c crc_x86.c crc_riscv.c crc_dispatch.c; do
+    object="$OUT/${file%.c}.o"
+    "$CC" -O2 -fPIC -c "$SRC/$file" -o "$object" || exit 1
+    objects+=("$object")
+done
+
+rm -f "$OUT/libcrcrt.a"
+ar rcs "$OUT/libcrcrt.a" "${objects[@]}" || exit 1
+
+echo "Built $OUT/libcrcrt.a"
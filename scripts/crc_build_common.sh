@@ -0,0 +1,66 @@
+# Helpers of the scripts that build programs with the CRC passes for x86-64
+# and riscv64, sourced by them:
+#   . "$ROOT/scripts/crc_build_common.sh"
+# LLVM_BIN has to be set before any of the helpers is called.
+#
+# Environment:
+#   RISCV_SYSROOT  sysroot of the riscv64 toolchain (default: /usr/riscv64-linux-gnu)
+#   QEMU_RISCV     qemu user mode emulator (default: qemu-riscv64)
+#   RISCV_CPU      qemu CPU model with the Zbc extension (default: rv64,zbc=true)
+
+CRC_ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+RISCV_SYSROOT=${RISCV_SYSROOT:-/usr/riscv64-linux-gnu}
+QEMU_RISCV=${QEMU_RISCV:-qemu-riscv64}
+RISCV_CPU=${RISCV_CPU:-rv64,zbc=true}
+
+# Pipeline of the loop level lowerings (-crc-lowering=table and libcall). They
+# need the loops in SSA form, so the functions are cleaned up after crcu8 has
+# been recognized and then looked at again, which also lowers the CRC steps
+# the first run has introduced.
+CRC_LOOP_PIPELINE='function(crc-recognition,sroa,loop-simplify,lcssa,crc-recognition),globaldce'
+
+# clang flags of a target
+target_flags() {
+    case $1 in
+        x86-64) echo "-march=x86-64" ;;
+        riscv64) echo "--target=riscv64-linux-gnu --sysroot=$RISCV_SYSROOT -march=rv64gc_zbc -static" ;;
+    esac
+}
+
+# Command prefix that runs a binary of a target
+target_runner() {
+    case $1 in
+        x86-64) echo "" ;;
+        riscv64) echo "$QEMU_RISCV -cpu $RISCV_CPU" ;;
+    esac
+}
+
+# Compile the CRC runtime (implementations/crc-runtime), which the libcall
+# lowering calls, for a target to one object per source in <output directory>.
+# build_crc_runtime_objects <target> <output directory>
+build_crc_runtime_objects() {
+    local flags out=$2
+    flags="$(target_flags "$1")"
+    mkdir -p "$out" || return 1
+    for file in "$CRC_ROOT"/implementations/crc-runtime/*.c; do
+        "$LLVM_BIN/clang" $flags -O2 -c "$file" -o "$out/$(basename "${file%.c}").o" || return 1
+    done
+}
+
+# Compile <source> through the CRC passes to <work directory>/<name>.o, with
+# <function> renamed to <function>_<name> so that the variants can be linked
+# together, and append the object to the objects array. The output of opt is
+# kept in <work directory>/<name>.log.
+# crc_variant <target> <work directory> <source> <function> <name> <opt flags> <opt pipeline>
+crc_variant() {
+    local target=$1 work=$2 src=$3 fn=$4 name=$5 pass_flags=$6 pipeline=$7
+    local flags
+    flags="$(target_flags "$target")"
+    "$LLVM_BIN/clang" $flags -O0 -Xclang -disable-O0-optnone -S -emit-llvm \
+        "$src" -D$fn=${fn}_$name -o "$work/$name.ll" &&
+    "$LLVM_BIN/opt" -S $pass_flags -passes="$pipeline" "$work/$name.ll" \
+        -o "$work/$name.crc.ll" 2>"$work/$name.log" &&
+    "$LLVM_BIN/clang" $flags ${OPT_LEVEL:--O2} -c "$work/$name.crc.ll" -o "$work/$name.o" &&
+    objects+=("$work/$name.o") ||
+    echo "Skipping variant $name, it could not be built"
+}